@@ -0,0 +1,125 @@
+// NmsBenchmark.cpp
+// Стоимость NMS на кадр: cv::dnn::NMSBoxes против nmsBoxes и сверка результатов.
+// Без файла используются синтетические кадры - скопления сдвинутых рамок вокруг людей,
+// как у выхода детектора до NMS. Записанные кандидаты детектора передаются файлом
+// cv::FileStorage (yml/json) с последовательностью "frames", в каждом кадре
+// "boxes" - матрица CV_32S Nx4 (x, y, w, h) и "scores" - CV_32F Nx1.
+// Запуск: ./nms_benchmark [итерации] [кандидаты.yml]
+
+#include "Nms.h"
+#include <opencv2/dnn.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+const float SCORE_THRESHOLD = 0.5f;
+const float NMS_THRESHOLD = 0.45f;
+const size_t MAX_DETECTIONS = 100;
+const int SYNTHETIC_FRAMES = 32;
+
+struct Frame {
+    std::vector<cv::Rect> boxes;
+    std::vector<float> scores;
+};
+
+std::vector<Frame> syntheticFrames() {
+    std::vector<Frame> frames(SYNTHETIC_FRAMES);
+    cv::RNG rng(42);
+    for (auto& frame : frames) {
+        int people = rng.uniform(1, 12);
+        for (int p = 0; p < people; ++p) {
+            cv::Rect person(rng.uniform(0, 1600), rng.uniform(0, 800), rng.uniform(40, 300), rng.uniform(100, 500));
+            int candidates = rng.uniform(5, 40);
+            for (int c = 0; c < candidates; ++c) {
+                int dx = rng.uniform(-person.width / 6, person.width / 6 + 1);
+                int dy = rng.uniform(-person.height / 6, person.height / 6 + 1);
+                int dw = rng.uniform(-person.width / 8, person.width / 8 + 1);
+                int dh = rng.uniform(-person.height / 8, person.height / 8 + 1);
+                frame.boxes.emplace_back(person.x + dx, person.y + dy, person.width + dw, person.height + dh);
+                // Грубая сетка оценок, чтобы проверить порядок при равенстве
+                frame.scores.push_back(std::round(rng.uniform(0.5f, 0.95f) * 100.0f) / 100.0f);
+            }
+        }
+    }
+    return frames;
+}
+
+std::vector<Frame> recordedFrames(const std::string& path) {
+    std::vector<Frame> frames;
+    cv::FileStorage storage(path, cv::FileStorage::READ);
+    if (!storage.isOpened()) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return frames;
+    }
+    for (const auto& node : storage["frames"]) {
+        cv::Mat boxes;
+        cv::Mat scores;
+        node["boxes"] >> boxes;
+        node["scores"] >> scores;
+        boxes.convertTo(boxes, CV_32S);
+        scores.convertTo(scores, CV_32F);
+
+        Frame frame;
+        for (int i = 0; i < boxes.rows; ++i) {
+            frame.boxes.emplace_back(boxes.at<int>(i, 0), boxes.at<int>(i, 1), boxes.at<int>(i, 2), boxes.at<int>(i, 3));
+        }
+        frame.scores.assign(scores.begin<float>(), scores.end<float>());
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+template <typename Fn>
+double measureUs(int iterations, size_t frames, Fn&& fn) {
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (iterations * frames);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::vector<Frame> frames = argc > 2 ? recordedFrames(argv[2]) : syntheticFrames();
+    if (frames.empty()) return 1;
+
+    std::vector<std::vector<int>> reference(frames.size());
+    std::vector<std::vector<int>> kept(frames.size());
+    std::vector<int> capped;
+
+    double reference_us = measureUs(iterations, frames.size(), [&] {
+        for (size_t f = 0; f < frames.size(); ++f) {
+            cv::dnn::NMSBoxes(frames[f].boxes, frames[f].scores, SCORE_THRESHOLD, NMS_THRESHOLD, reference[f]);
+        }
+    });
+    double kept_us = measureUs(iterations, frames.size(), [&] {
+        for (size_t f = 0; f < frames.size(); ++f) {
+            nmsBoxes(frames[f].boxes, frames[f].scores, SCORE_THRESHOLD, NMS_THRESHOLD, kept[f], MAX_DETECTIONS);
+        }
+    });
+
+    size_t candidates = 0;
+    size_t detections = 0;
+    size_t mismatched = 0;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        candidates += frames[f].boxes.size();
+        detections += kept[f].size();
+        // Ограничение числа рамок должно давать префикс полного результата
+        std::vector<int> expected(reference[f].begin(), reference[f].begin() + std::min(reference[f].size(), MAX_DETECTIONS));
+        nmsBoxes(frames[f].boxes, frames[f].scores, SCORE_THRESHOLD, NMS_THRESHOLD, capped, 3);
+        bool prefix = std::equal(capped.begin(), capped.end(), reference[f].begin()) && capped.size() == std::min<size_t>(3, reference[f].size());
+        if (kept[f] != expected || !prefix) ++mismatched;
+    }
+
+    std::printf("kernel: %s, iterations: %d, frames: %zu, candidates per frame: %.1f\n",
+        nmsKernelName(), iterations, frames.size(), static_cast<double>(candidates) / frames.size());
+    std::printf("NMSBoxes %8.2f us per frame\n", reference_us);
+    std::printf("nmsBoxes %8.2f us per frame  speedup %5.1fx\n", kept_us, reference_us / kept_us);
+    std::printf("detections: %zu, mismatched frames: %zu\n", detections, mismatched);
+    return mismatched == 0 ? 0 : 1;
+}
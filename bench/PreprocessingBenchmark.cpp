@@ -0,0 +1,59 @@
+// PreprocessingBenchmark.cpp
+// Сравнение blobFromImagesFused с cv::dnn::blobFromImages на кадрах камеры.
+// Запуск: ./preprocessing_benchmark [итерации]
+
+#include "Preprocessing.h"
+#include <opencv2/dnn.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Размер входа моделей и типичные размеры кадра, человека и кисти
+const int INPUT_SIZE = 640;
+const std::vector<cv::Size> SOURCE_SIZES = {{1920, 1080}, {640, 480}, {220, 480}, {96, 96}};
+
+template <typename Fn>
+double measureMs(int iterations, Fn&& fn) {
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    cv::Size input_size(INPUT_SIZE, INPUT_SIZE);
+    std::printf("kernel: %s, iterations: %d\n", preprocessingKernelName(), iterations);
+
+    for (const auto& source_size : SOURCE_SIZES) {
+        std::vector<cv::Mat> images(1, cv::Mat(source_size, CV_8UC3));
+        cv::randu(images[0], cv::Scalar::all(0), cv::Scalar::all(255));
+
+        // Прежний путь: OpenCV пишет в заранее выделенный блоб
+        int blob_sizes[] = {1, 3, INPUT_SIZE, INPUT_SIZE};
+        cv::Mat reference(4, blob_sizes, CV_32F);
+        double opencv_ms = measureMs(iterations, [&] {
+            cv::dnn::blobFromImages(images, reference, 1./255., input_size, cv::Scalar(), true, false);
+        });
+
+        cv::Mat fused(4, blob_sizes, CV_32F);
+        double fused_ms = measureMs(iterations, [&] {
+            blobFromImagesFused(images, input_size, fused.ptr<float>());
+        });
+
+        // OpenCV интерполирует в фиксированной точке, поэтому небольшое расхождение ожидаемо
+        double max_diff = cv::norm(reference, fused, cv::NORM_INF);
+
+        // Основной путь моделей: letterbox по закэшированным таблицам
+        double letterbox_ms = measureMs(iterations, [&] {
+            letterboxFromImagesFused(images, input_size, fused.ptr<float>());
+        });
+        std::printf("%5dx%-5d  blobFromImages %7.3f ms  fused %7.3f ms  speedup %5.2fx  max diff %.4f  letterbox %7.3f ms\n",
+            source_size.width, source_size.height, opencv_ms, fused_ms, opencv_ms / fused_ms, max_diff, letterbox_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// YoloDecoderBenchmark.cpp
+// Стоимость разбора выхода детектора на кадр: прежний путь через cv::minMaxLoc
+// по 80 классам каждого предложения против decodeYoloClass.
+// Запуск: ./yolo_decoder_benchmark [итерации]
+
+#include "YoloDecoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Выход YOLOv8 на входе 640x640
+const int NUM_CLASSES = 80;
+const int NUM_PROPOSALS = 8400;
+const int PERSON_CLASS_ID = 0;
+const float SCORE_THRESHOLD = 0.5f;
+// Предложения с высокой оценкой: люди и объекты других классов
+const int STRONG_PROPOSALS = 60;
+
+// Прежний разбор: заголовок cv::Mat над 80 оценками с шагом N и cv::minMaxLoc для каждого предложения
+std::vector<Detection> decodeWithMinMaxLoc(const float* output, int num_proposals) {
+    std::vector<Detection> detections;
+    for (int i = 0; i < num_proposals; ++i) {
+        const float* proposal_data = output + i;
+        cv::Mat scores(NUM_CLASSES, 1, CV_32F, (void*)(proposal_data + 4 * num_proposals), num_proposals * sizeof(float));
+        cv::Point class_id_point;
+        double max_score;
+        cv::minMaxLoc(scores, 0, &max_score, 0, &class_id_point);
+        if (max_score > SCORE_THRESHOLD && class_id_point.y == PERSON_CLASS_ID) {
+            float cx = proposal_data[0];
+            float cy = proposal_data[num_proposals];
+            float w = proposal_data[2 * num_proposals];
+            float h = proposal_data[3 * num_proposals];
+            detections.push_back({cv::Rect2f(cx - 0.5f * w, cy - 0.5f * h, w, h), static_cast<float>(max_score), i});
+        }
+    }
+    return detections;
+}
+
+template <typename Fn>
+double measureUs(int iterations, Fn&& fn) {
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 500;
+
+    // Фон - низкие оценки, как у реального выхода после sigmoid
+    cv::Mat output(4 + NUM_CLASSES, NUM_PROPOSALS, CV_32F);
+    cv::randu(output.rowRange(0, 4), cv::Scalar::all(0.0), cv::Scalar::all(640.0));
+    cv::randu(output.rowRange(4, 4 + NUM_CLASSES), cv::Scalar::all(0.0), cv::Scalar::all(0.1));
+    cv::RNG rng(42);
+    for (int k = 0; k < STRONG_PROPOSALS; ++k) {
+        int proposal = rng.uniform(0, NUM_PROPOSALS);
+        int class_id = k % 3 == 0 ? rng.uniform(1, NUM_CLASSES) : PERSON_CLASS_ID;
+        output.at<float>(4 + class_id, proposal) = rng.uniform(0.5f, 0.95f);
+    }
+    const float* data = output.ptr<float>();
+
+    std::vector<Detection> reference;
+    std::vector<Detection> decoded;
+    double reference_us = measureUs(iterations, [&] { reference = decodeWithMinMaxLoc(data, NUM_PROPOSALS); });
+    double decoded_us = measureUs(iterations, [&] {
+        decoded = decodeYoloClass(data, NUM_PROPOSALS, NUM_CLASSES, PERSON_CLASS_ID, SCORE_THRESHOLD);
+    });
+
+    bool same = reference.size() == decoded.size();
+    for (size_t i = 0; same && i < reference.size(); ++i) {
+        same = reference[i].box == decoded[i].box && reference[i].score == decoded[i].score && reference[i].proposal == decoded[i].proposal;
+    }
+
+    std::printf("kernel: %s, iterations: %d, proposals: %d\n", yoloDecoderKernelName(), iterations, NUM_PROPOSALS);
+    std::printf("minMaxLoc       %8.1f us per frame\n", reference_us);
+    std::printf("decodeYoloClass %8.1f us per frame  speedup %5.1fx\n", decoded_us, reference_us / decoded_us);
+    std::printf("detections: %zu, results %s\n", decoded.size(), same ? "match" : "DIFFER");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// AutoTuner.h
+#pragma once
+
+#include "ConfigManager.h"
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <map>
+
+// Подбор настроек инференса на текущей машине (режим --autotune).
+// Для каждой модели перебираются уровень оптимизации графа, размер батча
+// и разрешение входа (если вход модели динамический), для всех моделей вместе -
+// число потоков общего intra-op пула. Лучшие значения сохраняются в профиль,
+// который ConfigManager::loadTuningProfile применяет при следующих запусках.
+class AutoTuner {
+    public:
+        // frames - записанные кадры для прогонов, пусто - синтетический вход
+        explicit AutoTuner(std::vector<cv::Mat> frames);
+
+        // allowCuda = false для моделей, которые всегда работают на CPU
+        void addModel(const std::string& name, const std::string& path, bool allowCuda = true);
+
+        void run();
+        void save(const std::string& filepath) const;
+
+        // Кадры из каталога, нечитаемые файлы пропускаются
+        static std::vector<cv::Mat> loadFrames(const std::string& directory);
+
+    private:
+        struct ModelEntry {
+            std::string name;
+            std::string path;
+            bool allowCuda = true;
+            ModelConfig config;
+            double latencyMs = 0.0;
+        };
+
+        // Среднее время прогона на одно изображение, мс (отрицательное - конфигурация не работает)
+        double measure(const ModelEntry& model, const ModelConfig& config, int threads) const;
+
+        std::vector<cv::Mat> m_frames;
+        std::vector<ModelEntry> m_models;
+        int m_intraOpThreads = 0;
+};
@@ -5,8 +5,10 @@
 #include "ConfigManager.h"
 #include "SystemState.h"
 #include "HttpClient.h"
-#include "HumanDetector.h"
-#include "GestureRecognizer.h"
+#include "InferenceScheduler.h"
+#include "SpscQueue.h"
+#include "MotionGate.h"
+#include "PersonTracker.h"
 
 #include <opencv2/ximgproc.hpp> 
 #include <opencv2/opencv.hpp>
@@ -15,6 +17,56 @@
 #include <memory>
 #include <chrono>
 #include <mutex>
+#include <vector>
+#include <future>
+#include <unordered_map>
+
+// Кадр, проходящий через стадии конвейера камеры
+struct FramePacket {
+    cv::Mat frame;
+    std::chrono::steady_clock::time_point capturedAt;
+    cv::Rect roiRect;
+    cv::Mat roiFrame;
+    // Затвор движения закрыт: инференс не запускался, состояние жестов не меняется
+    bool motionSkipped = false;
+    // Детекция или распознавание кадра завершились ошибкой: кадр обрабатывается как пропущенный
+    bool inferenceFailed = false;
+    // Детекция выполняется асинхронно, результат забирает стадия распознавания
+    std::future<std::vector<cv::Rect>> pendingDetections;
+    // В однопроходном режиме вместо детекции - люди с позами от модели позы
+    std::future<std::vector<PoseInstance>> pendingPoses;
+    std::vector<cv::Rect> detections;
+    // Номер трека для каждой рамки detections
+    std::vector<int> trackIds;
+    // Номера треков, распознанных на этом кадре, в порядке results
+    std::vector<int> recognizedTracks;
+    // Вырез каждого распознанного трека и признак позы, взятой с прошлых кадров
+    std::vector<cv::Rect> recognizedRects;
+    std::vector<bool> reusedPoses;
+    // Распознавание тоже не блокирует свою стадию, результат забирает стадия действий
+    std::future<std::vector<RecognitionResult>> pendingResults;
+    // Распознавание неподвижных людей по позе с прошлых кадров, идёт в results после pendingResults
+    std::future<std::vector<RecognitionResult>> pendingReusedResults;
+    std::vector<RecognitionResult> results;
+};
+
+// Подтверждение жеста ведётся отдельно для каждого человека:
+// свидетельства в пользу кандидата копятся по вероятностям классификатора с весом по времени между кадрами
+struct TrackGestureState {
+    GestureType lastGesture = GestureType::NONE;
+    double evidence = 0.0;
+    int observations = 0; // Кадры, учтённые для текущего кандидата
+    std::chrono::steady_clock::time_point evidenceUpdatedAt;
+    // Последний выполненный жест и когда модель его последний раз видела
+    GestureType repeatBlocked = GestureType::NONE;
+    std::chrono::steady_clock::time_point repeatBlockedAt;
+
+    // Последняя поза от модели, вырез, на котором она посчитана, и его уменьшенная копия
+    std::vector<Keypoint> poseKeypoints;
+    cv::Rect poseRect;
+    cv::Mat poseThumbnail;
+    std::chrono::steady_clock::time_point poseRefreshedAt;
+};
 
 class CameraProcessor{
     public:
@@ -22,27 +74,59 @@ class CameraProcessor{
             const CameraConfig& config,
             std::shared_ptr<SystemState> systemState,
             std::shared_ptr<HttpClient> httpClient,
-            std::shared_ptr<HumanDetector> humanDetector,
-            std::shared_ptr<GestureRecognizer> gestureRecognizer
+            std::shared_ptr<InferenceScheduler> inferenceScheduler
         );
 
+        // Стадия захвата работает в вызывающем потоке, остальные стадии - в своих потоках
         void run();
 
         void stop();
         const CameraConfig& getConfig() const { return m_config; }
         cv::Mat getLatestFrame();
+        MotionGateStats getMotionStats() const { return m_motionGate.getStats(); }
 
     private:
-        void processFrame(cv::Mat& frame);
+        // Стадии конвейера: захват -> подготовка -> детекция -> распознавание -> действия
+        void captureLoop(cv::VideoCapture& cap);
+        void preprocessLoop();
+        void detectLoop();
+        void recognizeLoop();
+        void actionLoop();
+
+        // Индексы людей кадра, которых нужно распознать: кандидаты на жест - каждый кадр, остальные - реже
+        std::vector<size_t> selectForRecognition(const std::vector<int>& trackIds);
+        // Поза трека с прошлых кадров, если человек неподвижен и поза не устарела
+        bool reusablePose(int trackId, const cv::Mat& roiFrame, const cv::Rect& humanRect,
+            std::vector<Keypoint>& keypoints, cv::Rect& poseRect);
+
         void handleGesture(GestureType gesture);
         CameraConfig m_config;
         std::shared_ptr<SystemState> m_systemState;
         std::shared_ptr<HttpClient> m_httpClient;
-        std::shared_ptr<HumanDetector> m_humanDetector;
-        std::shared_ptr<GestureRecognizer> m_gestureRecognizer;
+        std::shared_ptr<InferenceScheduler> m_inferenceScheduler;
         
         std::atomic<bool> m_isRunning;
 
+        // Пропуск детекции на кадрах без движения
+        MotionGate m_motionGate;
+        // У какого-то трека есть кандидат на жест: затвор держится открытым,
+        // чтобы неподвижно показанный жест распознавался на каждом кадре
+        std::atomic<bool> m_gestureCandidate{false};
+
+        // Между ключевыми кадрами рамки людей ведёт трекер (стадия распознавания)
+        PersonTracker m_tracker;
+        std::chrono::steady_clock::time_point m_lastKeyframe;
+        // Трекер теряет людей - следующий кадр уходит в детектор
+        std::atomic<bool> m_forceKeyframe{true};
+        static constexpr float MIN_TRACK_CONFIDENCE = 0.5f;
+
+        // Очереди между стадиями
+        static constexpr size_t PIPELINE_QUEUE_CAPACITY = 2;
+        SpscQueue<FramePacket> m_captureQueue{PIPELINE_QUEUE_CAPACITY};
+        SpscQueue<FramePacket> m_preprocessQueue{PIPELINE_QUEUE_CAPACITY};
+        SpscQueue<FramePacket> m_detectQueue{PIPELINE_QUEUE_CAPACITY};
+        SpscQueue<FramePacket> m_recognizeQueue{PIPELINE_QUEUE_CAPACITY};
+
         // Контроль частоты запросов
         std::chrono::steady_clock::time_point m_lastRequestTime;
         std::chrono::seconds m_cooldownDuration;
@@ -50,8 +134,13 @@ class CameraProcessor{
         std::mutex m_frameMutex;
         cv::Mat m_latestFrame;
 
-        GestureType m_lastDetectedGesture;
-        int m_gestureCounter;
-        const int GESTURE_CONFIRMATION_FRAMES = 5;
+        // Состояние жестов по трекам пишет стадия действий, читает стадия распознавания
+        std::mutex m_trackStateMutex;
+        std::unordered_map<int, TrackGestureState> m_trackStates;
+        // Кадры с последнего распознавания трека (только стадия распознавания)
+        std::unordered_map<int, int> m_framesSinceRecognition;
+        // Человек без кандидата на жест распознаётся раз в столько кадров
+        const int IDLE_RECOGNITION_INTERVAL = 4;
+        // Поза неподвижного человека пересчитывается не реже этого интервала
+        const std::chrono::milliseconds POSE_REFRESH_INTERVAL{1000};
 };
-
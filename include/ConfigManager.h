@@ -13,6 +13,11 @@ struct CameraConfig{
     std::string videoUrl; // Путь к камере
     std::string APIUrl; // Адрес запроса
     std::vector<int> roi; // Область распознавания
+    int weight = 1; // Доля камеры в планировщике инференса
+    bool singlePass = false; // Люди и позы из одного прогона модели позы на всём ROI, без детектора
+    double motionThreshold = 0.0; // Доля изменившихся пикселей, при которой запускается детектор (0 - без затвора)
+    int motionKeepAliveMs = 1000; // Наибольший интервал между запусками детектора без движения
+    double detectFps = 0.0; // Полных детекций в секунду, между ними рамки ведёт трекер (0 - детекция на каждом кадре)
 };
 
 // Хранение времени начала и конца работы в минутах от начала суток
@@ -21,6 +26,23 @@ struct WorkingTime{
     std::chrono::minutes end{0};
 };
 
+// Глобальные пулы потоков ONNX Runtime
+struct OrtThreadingConfig{
+    int intraOpThreads = 0; // 0 - по числу физических ядер
+    int interOpThreads = 1;
+    bool allowSpinning = false; // Активное ожидание потоков пула
+};
+
+// Настройки пула реплик модели
+struct ModelConfig{
+    int replicas = 1;
+    std::vector<int> pinnedCameras; // Камеры с собственной репликой
+    std::string optimizationLevel = "all"; // Уровень оптимизации графа: disable, basic, extended, all
+    int inputSize = 0; // Сторона квадратного входа, 0 - из модели
+    int batchSize = 0; // Ограничение батча одного прогона, 0 - без ограничения
+    std::string inputFormat = "float_nchw"; // float_nchw или uint8_nhwc (нормализация внутри графа)
+};
+
 class ConfigManager {
     public:
         ConfigManager(const ConfigManager&) = delete;
@@ -29,8 +51,17 @@ class ConfigManager {
         void operator=(const ConfigManager&) = delete;
 
         void load(const std::string& filepath);
+        // Профиль автонастройки поверх конфигурации, false - файла нет
+        bool loadTuningProfile(const std::string& filepath);
         
         const std::string& getDevice() const;
+        int getDetectorBatchSize() const;
+        std::chrono::milliseconds getDetectorBatchTimeout() const;
+        const OrtThreadingConfig& getThreadingConfig() const;
+        int getSchedulerWorkers() const;
+        double getAutotuneBudgetMs() const;
+        // Имена моделей: detector, body_pose, hand_pose, classifier
+        ModelConfig getModelConfig(const std::string& modelName) const;
         const std::vector<CameraConfig>& getCameraConfigs() const;
 
         bool isWorkTime() const;
@@ -40,6 +71,14 @@ class ConfigManager {
     private:
         ConfigManager() = default;
         std::string m_device;
+        // Кросс-камерный батчинг детектора
+        int m_detectorBatchSize = 8;
+        std::chrono::milliseconds m_detectorBatchTimeout{5};
+        OrtThreadingConfig m_threadingConfig;
+        int m_schedulerWorkers = 1;
+        // Допустимое время инференса на изображение при выборе разрешения автонастройкой
+        double m_autotuneBudgetMs = 10.0;
+        std::map<std::string, ModelConfig> m_modelConfigs;
         // Парсинг времени из строки "ЧЧ:MM"
         std::chrono::minutes parseTime(const std::string& timeStr) const;
 
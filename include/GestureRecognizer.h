@@ -7,6 +7,7 @@
 #include <vector>
 #include <memory>
 #include <filesystem>
+#include "SessionPool.h"
 
 enum class GestureType {
     NONE,
@@ -17,24 +18,29 @@ enum class GestureType {
     THUMBS_DOWN
 };
 
+const size_t GESTURE_TYPE_COUNT = 6;
+
 struct Keypoint {
     cv::Point2f point;
     float confidence;
 };
 
+// Человек, найденный моделью позы: рамка и точки в координатах изображения
+struct PoseInstance {
+    cv::Rect2f box;
+    float score = 0.0f;
+    std::vector<Keypoint> keypoints;
+};
+
 struct RecognitionResult {
     GestureType finalGesture = GestureType::NONE;
+    // Вероятности классификатора, индекс - значение GestureType
+    std::vector<float> gestureProbabilities;
     std::vector<Keypoint> poseKeypoints;
     std::vector<Keypoint> leftHandKeypoints;
     std::vector<Keypoint> rightHandKeypoints;
 };
 
-namespace Ort {
-    struct Env;
-    struct Session;
-    struct SessionOptions;
-}
-
 class GestureRecognizer {
 public:
     GestureRecognizer();
@@ -44,20 +50,28 @@ public:
     void loadHandPoseModel(const std::string& path);
     void loadClassifierModel(const std::string& path);
 
-    RecognitionResult recognize(const cv::Mat& personFrame);
+    RecognitionResult recognize(const cv::Mat& personFrame, int cameraId = -1);
+    // Распознавание сразу для нескольких людей: позы, кисти и классификатор идут одним батчем каждый.
+    // cameraId выбирает закреплённые за камерой реплики, -1 - любые общие
+    std::vector<RecognitionResult> recognizeBatch(const std::vector<cv::Mat>& personFrames, int cameraId = -1);
 
-private:
-    std::unique_ptr<Ort::Env> m_bodyPoseEnv;
-    std::unique_ptr<Ort::Session> m_bodyPoseSession;
-    std::unique_ptr<Ort::SessionOptions> m_bodyPoseSessionOptions;
+    // Все люди на изображениях за один прогон модели позы (NMS по рамкам): вместо прогона
+    // на вырезе каждого человека модель запускается один раз на ROI целиком
+    std::vector<std::vector<PoseInstance>> detectPoses(const std::vector<cv::Mat>& frames, int cameraId = -1);
+    // Распознавание по уже найденным точкам позы: кисти и классификатор без модели позы тела.
+    // poses[i] задана в координатах frames[i] (один кадр может повторяться для нескольких людей)
+    std::vector<RecognitionResult> recognizeFromPoses(
+        const std::vector<cv::Mat>& frames, std::vector<std::vector<Keypoint>> poses, int cameraId = -1);
 
-    std::unique_ptr<Ort::Env> m_handPoseEnv;
-    std::unique_ptr<Ort::Session> m_handPoseSession;
-    std::unique_ptr<Ort::SessionOptions> m_handPoseSessionOptions;
+    bool isPinned(int cameraId) const;
 
-    std::unique_ptr<Ort::Env> m_classifierEnv;
-    std::unique_ptr<Ort::Session> m_classifierSession;
-    std::unique_ptr<Ort::SessionOptions> m_classifierSessionOptions;
+private:
+    std::unique_ptr<SessionPool> m_bodyPosePool;
+    std::unique_ptr<SessionPool> m_handPosePool;
+    std::unique_ptr<SessionPool> m_classifierPool;
+    // Стороны квадратных входов моделей поз
+    int m_bodyPoseInputSize = 0;
+    int m_handPoseInputSize = 0;
     
     std::vector<GestureType> m_classMap;
 };
\ No newline at end of file
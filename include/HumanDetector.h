@@ -4,27 +4,51 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <string>
-#include <chrono>
 #include <memory>
-
-namespace Ort {
-    struct Env;
-    struct Session;
-    struct SessionOptions;
-}
+#include <future>
+#include <functional>
+#include <exception>
+#include "SessionPool.h"
 
 class HumanDetector {
     public:
+        // Результат асинхронной детекции, вызывается в потоке пула ONNX Runtime
+        using DetectCallback = std::function<void(std::vector<std::vector<cv::Rect>> detections, std::exception_ptr error)>;
+
         HumanDetector();
         ~HumanDetector();
 
         void loadModel(const std::string& path);
 
-        std::vector<cv::Rect> detect(const cv::Mat& frame);
+        std::vector<cv::Rect> detect(const cv::Mat& frame, int cameraId = -1);
+        // Кадры вписываются во вход модели с сохранением пропорций (letterbox),
+        // рамки возвращаются в координатах кадра. Модель с динамическими высотой и шириной
+        // получает вход под пропорции кадра, без лишних полей; кадры разной формы идут разными прогонами.
+        // Модели со встроенными разбором и NMS (выход [K, 6] или [B, K, 6]) распознаются по форме выхода,
+        // их рамки читаются напрямую, без разбора предложений на CPU.
+        // Один прогон модели на несколько кадров, результат для каждого кадра.
+        // cameraId выбирает закреплённую за камерой реплику, -1 - любая общая
+        std::vector<std::vector<cv::Rect>> detectBatch(const std::vector<cv::Mat>& frames, int cameraId = -1);
+
+        // Асинхронная детекция через RunAsync: вызывающий поток занят только подготовкой входа
+        std::future<std::vector<std::vector<cv::Rect>>> detectBatchAsync(const std::vector<cv::Mat>& frames, int cameraId = -1);
+        void detectBatchAsync(const std::vector<cv::Mat>& frames, int cameraId, DetectCallback callback);
+
+        bool isPinned(int cameraId) const;
+
+        // Заранее прогоняет модель на формах входа для кадров этих размеров (ROI камер)
+        // и на всех батчах, которые может собрать планировщик (до maxBatchSize)
+        void warmup(const std::vector<cv::Size>& frameSizes, int maxBatchSize);
 
     private:
-        std::unique_ptr<Ort::Env> m_env;
-        std::unique_ptr<Ort::Session> m_session;
-        std::unique_ptr<Ort::SessionOptions> m_sessionOptions;
-        std::chrono::steady_clock::time_point m_startTime;
-};
\ No newline at end of file
+        // Форма входа для кадра: квадрат m_inputSize или, у модели с динамическим входом,
+        // прямоугольник с длинной стороной m_inputSize и пропорциями кадра, кратный шагу сетки
+        cv::Size inputSizeFor(const cv::Size& frameSize) const;
+
+        std::unique_ptr<SessionPool> m_pool;
+        // Сторона квадратного входа модели, для динамического входа - длинная сторона
+        int m_inputSize = 0;
+        bool m_dynamicShape = false;
+        // Модель сама разбирает предложения и выполняет NMS, выход - готовые рамки
+        bool m_endToEnd = false;
+};
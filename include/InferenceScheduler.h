@@ -0,0 +1,113 @@
+// InferenceScheduler.h
+#pragma once
+
+#include "ConfigManager.h"
+#include "HumanDetector.h"
+#include "GestureRecognizer.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <deque>
+#include <map>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Состояние очереди камеры для мониторинга
+struct CameraQueueStats {
+    size_t queueDepth = 0;
+    double avgWaitMs = 0.0;
+    double lastWaitMs = 0.0;
+    uint64_t servedJobs = 0;
+};
+
+// Центральный планировщик инференса. Владеет детектором и распознавателем,
+// принимает запросы от камер и обслуживает их по deficit round-robin с весами камер.
+// Запросы детекции, выбранные за один раунд, объединяются в общий батч,
+// запросы поз однопроходного режима - в общий detectPoses, запросы распознавания - в общий recognizeBatch.
+// Камеры с закреплёнными репликами обслуживаются отдельными батчами на своих репликах.
+// Несколько рабочих потоков позволяют использовать несколько реплик моделей параллельно.
+class InferenceScheduler {
+    public:
+        InferenceScheduler(
+            std::unique_ptr<HumanDetector> humanDetector,
+            std::unique_ptr<GestureRecognizer> gestureRecognizer,
+            const std::vector<CameraConfig>& cameraConfigs,
+            int maxBatchSize,
+            std::chrono::milliseconds maxBatchDelay,
+            int workers = 1
+        );
+        ~InferenceScheduler();
+
+        std::future<std::vector<cv::Rect>> submitDetect(int cameraId, const cv::Mat& frame);
+        std::future<std::vector<RecognitionResult>> submitRecognize(int cameraId, std::vector<cv::Mat> personFrames);
+        // Однопроходный режим: люди и их позы из одного прогона модели позы на кадре
+        std::future<std::vector<PoseInstance>> submitPoses(int cameraId, const cv::Mat& frame);
+        // Распознавание по готовым позам, найденным на кадре frame
+        std::future<std::vector<RecognitionResult>> submitRecognize(int cameraId, const cv::Mat& frame, std::vector<std::vector<Keypoint>> poses);
+        // Распознавание по готовым позам, у каждой позы - своё изображение
+        std::future<std::vector<RecognitionResult>> submitRecognize(int cameraId, std::vector<cv::Mat> personFrames, std::vector<std::vector<Keypoint>> poses);
+
+        CameraQueueStats getStats(int cameraId) const;
+        std::map<int, CameraQueueStats> getAllStats() const;
+
+        void stop();
+
+    private:
+        enum class JobType {
+            DETECT,
+            POSE,
+            RECOGNIZE
+        };
+
+        struct Job {
+            JobType type;
+            int cameraId;
+            // Стоимость задачи в единицах инференса (для распознавания - число людей)
+            int cost;
+            std::chrono::steady_clock::time_point enqueuedAt;
+            cv::Mat frame;
+            std::vector<cv::Mat> personFrames;
+            // Позы людей для распознавания без модели позы тела, в координатах personFrames
+            std::vector<std::vector<Keypoint>> poses;
+            std::promise<std::vector<cv::Rect>> detectPromise;
+            std::promise<std::vector<PoseInstance>> posePromise;
+            std::promise<std::vector<RecognitionResult>> recognizePromise;
+        };
+
+        struct CameraQueue {
+            int weight = 1;
+            int deficit = 0;
+            std::deque<Job> jobs;
+            CameraQueueStats stats;
+        };
+
+        void enqueue(Job&& job);
+        void workerLoop();
+        // Один раунд DRR по всем камерам, вызывается под m_mutex
+        std::vector<Job> selectJobsLocked();
+        void runDetectJobs(std::vector<Job>& jobs, int cameraId);
+        void runPoseJobs(std::vector<Job>& jobs, int cameraId);
+        void runRecognizeJobs(std::vector<Job>& jobs, int cameraId);
+
+        std::unique_ptr<HumanDetector> m_humanDetector;
+        std::unique_ptr<GestureRecognizer> m_gestureRecognizer;
+        size_t m_maxBatchSize;
+        std::chrono::milliseconds m_maxBatchDelay;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::map<int, CameraQueue> m_queues;
+        std::vector<int> m_cameraOrder;
+        size_t m_roundStart = 0;
+        size_t m_pendingJobs = 0;
+        // Детекции среди m_pendingJobs: по ним набирается батч детектора
+        size_t m_pendingDetectJobs = 0;
+
+        std::atomic<bool> m_isRunning;
+        std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,45 @@
+// MotionGate.h
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Счётчики решений затвора движения
+struct MotionGateStats {
+    uint64_t opened = 0;     // Кадры с движением, детектор запущен
+    uint64_t keepAlive = 0;  // Движения нет, детектор запущен по интервалу
+    uint64_t held = 0;       // Движения нет, затвор удержан открытым (идёт подтверждение жеста)
+    uint64_t skipped = 0;    // Кадры без движения, детектор пропущен
+    double lastMotion = 0.0; // Доля изменившихся пикселей на последнем кадре
+};
+
+// Затвор движения перед детектором. Кадр уменьшается до малого полутонового изображения
+// и сравнивается с фоном - приближённой медианой, которая сдвигается к кадру не больше чем на шаг за кадр.
+// Разность, подсчёт изменившихся пикселей и обновление фона выполняются одним векторным
+// проходом (AVX2, на остальных процессорах - скалярная версия).
+// Детектор запускается, если доля изменившихся пикселей больше threshold или с последнего
+// запуска прошло keepAlive. threshold <= 0 отключает затвор.
+class MotionGate {
+    public:
+        MotionGate(double threshold, std::chrono::milliseconds keepAlive);
+
+        // Вызывается для каждого кадра одним потоком. holdOpen - запустить детектор
+        // независимо от движения (фон при этом обновляется)
+        bool shouldRun(const cv::Mat& frame, bool holdOpen = false);
+
+        MotionGateStats getStats() const;
+
+    private:
+        double m_threshold;
+        std::chrono::milliseconds m_keepAlive;
+        std::chrono::steady_clock::time_point m_lastRun;
+
+        cv::Mat m_small;
+        cv::Mat m_gray;
+        cv::Mat m_background;
+
+        mutable std::mutex m_statsMutex;
+        MotionGateStats m_stats;
+};
@@ -0,0 +1,34 @@
+// Nms.h
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <cstddef>
+
+// Подавление немаксимумов с семантикой cv::dnn::NMSBoxes (eta = 1, top_k = 0):
+// остаются рамки с оценкой выше score_threshold, у которых IoU со всеми уже оставленными
+// рамками не больше iou_threshold, порядок - по убыванию оценки (при равенстве - по индексу).
+// Кандидаты извлекаются из кучи по одному, поэтому при max_detections > 0 работа
+// прекращается, как только набрано нужное число рамок. IoU кандидата со всеми оставленными
+// рамками считается векторно (AVX2), рабочие буферы переиспользуются между вызовами в потоке.
+// indices - индексы оставленных рамок.
+void nmsBoxes(
+    const std::vector<cv::Rect2f>& boxes,
+    const std::vector<float>& scores,
+    float score_threshold,
+    float iou_threshold,
+    std::vector<int>& indices,
+    size_t max_detections = 0
+);
+
+void nmsBoxes(
+    const std::vector<cv::Rect>& boxes,
+    const std::vector<float>& scores,
+    float score_threshold,
+    float iou_threshold,
+    std::vector<int>& indices,
+    size_t max_detections = 0
+);
+
+// Название выбранной реализации IoU (для бенчмарка)
+const char* nmsKernelName();
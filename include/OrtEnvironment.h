@@ -0,0 +1,39 @@
+// OrtEnvironment.h
+#pragma once
+
+#include <string>
+#include <memory>
+#include "ConfigManager.h"
+
+namespace Ort {
+    struct Env;
+    struct SessionOptions;
+}
+
+// Единое на процесс окружение ONNX Runtime с глобальными пулами потоков.
+// Все сессии создаются с DisablePerSessionThreads и делят эти пулы,
+// поэтому число потоков инференса не растёт с числом моделей и камер.
+class OrtEnvironment {
+    public:
+        OrtEnvironment(const OrtEnvironment&) = delete;
+        void operator=(const OrtEnvironment&) = delete;
+
+        // Создаётся при первом обращении, после загрузки конфигурации
+        static OrtEnvironment& getInstance();
+
+        Ort::Env& getEnv();
+
+        // Опции сессии с общими пулами и провайдером из конфигурации.
+        // perSessionThreads > 0 - собственный пул сессии вместо общего (для автонастройки)
+        Ort::SessionOptions createSessionOptions(
+            const std::string& modelName,
+            const ModelConfig& config,
+            bool allowCuda = true,
+            int perSessionThreads = 0
+        ) const;
+
+    private:
+        OrtEnvironment();
+        ~OrtEnvironment();
+        std::unique_ptr<Ort::Env> m_env;
+};
@@ -0,0 +1,85 @@
+// OrtModel.h
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <exception>
+
+namespace Ort {
+    struct Env;
+    struct Session;
+    struct SessionOptions;
+}
+
+// Сессия ONNX Runtime с заранее выделенными входными и выходными тензорами.
+// Для каждой формы входа создаётся свой IoBinding, который переиспользуется между кадрами,
+// поэтому на горячем пути нет ни выделения памяти, ни создания тензоров.
+//
+// Порядок работы:
+//   T* input = model.prepareInput<T>(shape);  // заполнить вход
+//   model.run();
+//   const U* out = model.outputData<U>(0);
+//
+// Буферы привязок общие, поэтому весь цикл вход-запуск-выход выполняет один владелец:
+// модель берётся только через аренду SessionPool, которая даёт исключительный доступ к реплике.
+// runAsync() запускает модель через RunAsync и возвращает управление сразу.
+// До вызова completion буферы привязки заняты, поэтому аренда держится до конца обработки результата.
+class OrtModel {
+    public:
+        // Вызывается в потоке пула ONNX Runtime, error пустой при успехе
+        using Completion = std::function<void(std::exception_ptr error)>;
+
+        // outputNames - выходы, которые нужно вычислять (пусто - все выходы модели)
+        OrtModel(
+            Ort::Env& env,
+            const std::string& path,
+            const Ort::SessionOptions& sessionOptions,
+            const std::vector<std::string>& outputNames = {}
+        );
+        ~OrtModel();
+
+        OrtModel(const OrtModel&) = delete;
+        OrtModel& operator=(const OrtModel&) = delete;
+
+        // Выбирает (или создаёт при первом обращении) привязку для формы входа
+        void* prepareInput(const std::vector<int64_t>& shape);
+        void run();
+        void runAsync(Completion completion);
+
+        const void* outputBuffer(size_t index) const;
+        std::vector<int64_t> outputShape(size_t index) const;
+
+        template <typename T>
+        T* prepareInput(const std::vector<int64_t>& shape) { return static_cast<T*>(prepareInput(shape)); }
+
+        template <typename T>
+        const T* outputData(size_t index) const { return static_cast<const T*>(outputBuffer(index)); }
+
+        // Форма входа из метаданных модели, динамические размерности равны -1
+        const std::vector<int64_t>& inputShape() const { return m_inputShape; }
+        // Форма выхода index из метаданных модели, динамические размерности равны -1
+        std::vector<int64_t> modelOutputShape(size_t index) const;
+        // Фиксированный батч модели: вход должен иметь ровно столько изображений (0 - динамический размер)
+        int64_t batchSize() const;
+        // Вход uint8 вместо float
+        bool hasUint8Input() const { return m_uint8Input; }
+
+    private:
+        struct Binding;
+
+        Binding& createBinding(const std::vector<int64_t>& shape);
+
+        std::unique_ptr<Ort::Session> m_session;
+        std::string m_inputName;
+        std::vector<int64_t> m_inputShape;
+        bool m_uint8Input = false;
+        std::vector<std::string> m_outputNames;
+        std::vector<const char*> m_outputNamePtrs;
+
+        std::map<std::vector<int64_t>, std::unique_ptr<Binding>> m_bindings;
+        Binding* m_current = nullptr;
+};
@@ -0,0 +1,42 @@
+// PersonTracker.h
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Человек, которого трекер ведёт между кадрами
+struct Track {
+    int id = 0;
+    cv::Rect2f box;
+    float confidence = 1.0f; // Доля точек рамки, надёжно прослеженных на последнем кадре
+    int misses = 0;          // Ключевые кадры подряд, на которых детектор не подтвердил трек
+};
+
+// Трекер людей для пропуска детектора между ключевыми кадрами.
+// На ключевом кадре треки жадно сопоставляются с детекциями по IoU, несопоставленные детекции
+// становятся новыми треками. Между ключевыми кадрами рамка сдвигается на медиану
+// оптического потока сетки точек внутри неё (Лукас-Канаде с проверкой вперёд-назад).
+// Используется одним потоком.
+class PersonTracker {
+    public:
+        // Ключевой кадр: рамки берутся от детектора. Возвращает номера треков для детекций
+        std::vector<int> update(const cv::Mat& frame, const std::vector<cv::Rect>& detections);
+
+        // Кадр без детекции: рамки переносятся оптическим потоком.
+        // Возвращает наименьшую уверенность среди треков (1, если треков нет)
+        float propagate(const cv::Mat& frame);
+
+        const std::vector<Track>& tracks() const { return m_tracks; }
+
+    private:
+        void toGray(const cv::Mat& frame, cv::Mat& gray) const;
+
+        std::vector<Track> m_tracks;
+        int m_nextId = 1;
+
+        cv::Mat m_prevGray;
+        cv::Mat m_gray;
+        std::vector<cv::Point2f> m_points;
+        std::vector<cv::Point2f> m_forward;
+        std::vector<cv::Point2f> m_backward;
+};
@@ -0,0 +1,48 @@
+// Preprocessing.h
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <cstdint>
+
+// Подготовка входа YOLO-моделей за один проход по кадру:
+// билинейный resize + BGR->RGB + масштаб 1/255 + планарная раскладка NCHW.
+// Результат пишется в буфер вызывающего (обычно привязанный входной тензор OrtModel),
+// поэтому промежуточных изображений и блобов не создаётся.
+// Ядро векторизовано под AVX2 и AVX-512, набор инструкций выбирается при запуске,
+// на остальных процессорах работает скалярная версия.
+// Таблицы интерполяции кэшируются по геометрии источника, поэтому для ROI камеры
+// постоянного размера подготовка кадра сводится к выборке по готовым таблицам.
+
+// Геометрия letterbox: изображение вписано в вход модели с масштабом scale и отступом offset.
+// Масштабы по осям хранятся отдельно: после округления размера вписанной части они чуть различаются
+struct LetterboxTransform {
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    cv::Point2f offset;
+
+    // Обратное преобразование из координат входа модели в координаты исходного изображения
+    cv::Point2f toSource(const cv::Point2f& point) const;
+    cv::Rect2f toSource(const cv::Rect2f& rect) const;
+};
+
+// Растяжение без сохранения пропорций, blob - буфер [3, size.height, size.width]
+void blobFromImageFused(const cv::Mat& image, const cv::Size& size, float* blob);
+
+// blob - буфер [images.size(), 3, size.height, size.width]
+void blobFromImagesFused(const std::vector<cv::Mat>& images, const cv::Size& size, float* blob);
+
+// Вписывание с сохранением пропорций и серыми полями, blob - буфер [3, size.height, size.width]
+LetterboxTransform letterboxFromImageFused(const cv::Mat& image, const cv::Size& size, float* blob);
+
+// blob - буфер [images.size(), 3, size.height, size.width], преобразование для каждого изображения
+std::vector<LetterboxTransform> letterboxFromImagesFused(const std::vector<cv::Mat>& images, const cv::Size& size, float* blob);
+
+// Вход uint8 NHWC для моделей, у которых масштаб 1/255, BGR->RGB и перестановка осей встроены в граф.
+// Кадр копируется в тензор как есть (BGR), меняется только размер: в 4 раза меньше памяти и без
+// отдельного прохода нормализации. blob - буфер [images.size(), size.height, size.width, 3]
+LetterboxTransform letterboxFromImageU8(const cv::Mat& image, const cv::Size& size, uint8_t* blob);
+std::vector<LetterboxTransform> letterboxFromImagesU8(const std::vector<cv::Mat>& images, const cv::Size& size, uint8_t* blob);
+
+// Название выбранной реализации ядра (для логов и бенчмарка)
+const char* preprocessingKernelName();
@@ -0,0 +1,92 @@
+// SessionPool.h
+#pragma once
+
+#include "ConfigManager.h"
+#include "OrtModel.h"
+#include "Preprocessing.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// Пул реплик одной модели. Реплики выдаются в аренду на время инференса,
+// часть реплик может быть закреплена за отдельными камерами.
+class SessionPool {
+    public:
+        // Аренда реплики, при разрушении реплика возвращается в пул.
+        // Пока аренда жива, репликой пользуется только её владелец
+        class Lease {
+            public:
+                Lease(SessionPool* pool, size_t index) : m_pool(pool), m_index(index) {}
+                ~Lease();
+                Lease(Lease&& other) noexcept;
+                Lease(const Lease&) = delete;
+                Lease& operator=(const Lease&) = delete;
+
+                OrtModel& operator*() const { return *m_pool->m_replicas[m_index]; }
+                OrtModel* operator->() const { return m_pool->m_replicas[m_index].get(); }
+
+            private:
+                SessionPool* m_pool;
+                size_t m_index;
+        };
+
+        SessionPool(
+            const std::string& name,
+            const std::string& path,
+            const ModelConfig& config,
+            const std::vector<std::string>& outputNames,
+            bool allowCuda = true
+        );
+        // Дожидается возврата всех аренд, асинхронные запуски могут ещё держать реплики
+        ~SessionPool();
+
+        // Закреплённая камера получает свою реплику, остальные - любую свободную общую
+        Lease checkout(int cameraId = -1);
+
+        bool isPinned(int cameraId) const;
+        size_t size() const { return m_replicas.size(); }
+        // Метаданные одинаковы у всех реплик
+        const OrtModel& model() const { return *m_replicas.front(); }
+
+        // Наибольший батч одного прогона: фиксированный батч модели
+        // или ограничение из конфигурации (0 - без ограничения)
+        int64_t batchSize() const;
+        // Сторона квадратного входа: из модели, для динамического входа - из конфигурации, иначе fallback
+        int inputSize(int fallback) const;
+        // Вход uint8 NHWC с нормализацией внутри графа (input_format в конфигурации)
+        bool uint8Input() const { return m_uint8Input; }
+
+        // Высота и ширина входа динамические: форму можно подбирать под пропорции изображения
+        bool dynamicSpatialShape() const;
+
+        // Вписывает изображения во вход реплики в формате модели, возвращает обратные преобразования.
+        // Для модели с фиксированным батчем вход дополняется нулевыми изображениями до батча модели,
+        // выходы дополнительных мест вызывающий пропускает (преобразования есть только для images)
+        std::vector<LetterboxTransform> prepareImages(OrtModel& replica, const std::vector<cv::Mat>& images, const cv::Size& inputSize) const;
+
+        // Прогоняет каждую реплику на каждой форме входа, чтобы привязки и подготовка ORT
+        // к новой форме выполнялись при запуске, а не на первом кадре.
+        // Модель с динамическим батчем прогоняется на всех батчах от 1 до maxBatch
+        // (не больше ограничения из конфигурации), с фиксированным - на своём батче
+        void warmup(const std::vector<cv::Size>& inputSizes, int64_t maxBatch);
+
+    private:
+        // Аренда конкретной реплики, ждёт её освобождения
+        Lease checkoutReplica(size_t index);
+        void checkin(size_t index);
+
+        std::string m_name;
+        ModelConfig m_config;
+        bool m_uint8Input = false;
+        std::vector<std::unique_ptr<OrtModel>> m_replicas;
+        std::vector<bool> m_busy;
+        std::vector<size_t> m_sharedReplicas;
+        std::map<int, size_t> m_pinnedReplicas;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+};
@@ -0,0 +1,112 @@
+// SpscQueue.h
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Ограниченная lock-free очередь для одного производителя и одного потребителя.
+// Используется для связи стадий конвейера обработки кадров.
+// tryPush/tryPop не блокируются; waitPush/waitPop спят на условной переменной,
+// пока не появится место или элемент, или пока не сброшен флаг работы (после сброса - wakeAll).
+template <typename T>
+class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity)
+            : m_buffer(capacity + 1), m_head(0), m_tail(0) {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // Возвращает false, если очередь заполнена
+        bool tryPush(T&& item) {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            const size_t next = increment(tail);
+            if (next == m_head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            m_buffer[tail] = std::move(item);
+            m_tail.store(next, std::memory_order_release);
+            notify(m_notEmpty);
+            return true;
+        }
+
+        // Возвращает false, если очередь пуста
+        bool tryPop(T& item) {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = std::move(m_buffer[head]);
+            m_buffer[head] = T();
+            m_head.store(increment(head), std::memory_order_release);
+            notify(m_notFull);
+            return true;
+        }
+
+        // Возвращает false, если isRunning сброшен до того, как появилось место
+        bool waitPush(T&& item, const std::atomic<bool>& isRunning) {
+            while (!tryPush(std::move(item))) {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                m_notFull.wait(lock, [&] { return !isRunning.load() || !full(); });
+                if (!isRunning.load()) return false;
+            }
+            return true;
+        }
+
+        // Возвращает false, если isRunning сброшен до того, как появился элемент
+        bool waitPop(T& item, const std::atomic<bool>& isRunning) {
+            while (!tryPop(item)) {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                m_notEmpty.wait(lock, [&] { return !isRunning.load() || !empty(); });
+                if (!isRunning.load()) return false;
+            }
+            return true;
+        }
+
+        // Будит ждущие потоки, чтобы они перепроверили флаг работы
+        void wakeAll() {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+        }
+
+        size_t size() const {
+            const size_t head = m_head.load(std::memory_order_acquire);
+            const size_t tail = m_tail.load(std::memory_order_acquire);
+            return tail >= head ? tail - head : tail + m_buffer.size() - head;
+        }
+
+        size_t capacity() const { return m_buffer.size() - 1; }
+
+    private:
+        size_t increment(size_t index) const {
+            return index + 1 == m_buffer.size() ? 0 : index + 1;
+        }
+
+        bool empty() const {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+
+        bool full() const {
+            return increment(m_tail.load(std::memory_order_acquire)) == m_head.load(std::memory_order_acquire);
+        }
+
+        // Проход через мьютекс после изменения индекса: ждущий поток не пропустит уведомление
+        void notify(std::condition_variable& condition) {
+            { std::lock_guard<std::mutex> lock(m_waitMutex); }
+            condition.notify_one();
+        }
+
+        std::vector<T> m_buffer;
+        // Голова и хвост в разных кэш-линиях, чтобы потоки стадий не мешали друг другу
+        alignas(64) std::atomic<size_t> m_head;
+        alignas(64) std::atomic<size_t> m_tail;
+
+        std::mutex m_waitMutex;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+};
@@ -0,0 +1,29 @@
+// YoloDecoder.h
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Предложение детектора в координатах входа модели
+struct Detection {
+    cv::Rect2f box;
+    float score = 0.0f;
+    // Номер предложения в выходе модели (для чтения остальных его полей, например точек позы)
+    int proposal = -1;
+};
+
+// Разбор выхода YOLO [4 + num_classes, N] для одного класса.
+// Строка оценок класса просматривается одним непрерывным векторным проходом (AVX2/AVX-512,
+// скалярная версия на остальных процессорах), остальные классы читаются только у прошедших
+// порог предложений - чтобы сохранить семантику argmax: предложение остаётся,
+// только если class_id - класс с наибольшей оценкой.
+std::vector<Detection> decodeYoloClass(
+    const float* output,
+    int num_proposals,
+    int num_classes,
+    int class_id,
+    float score_threshold
+);
+
+// Название выбранной реализации порогового прохода (для бенчмарка)
+const char* yoloDecoderKernelName();
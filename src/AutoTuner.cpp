@@ -0,0 +1,237 @@
+// AutoTuner.cpp
+
+#include "AutoTuner.h"
+#include "OrtEnvironment.h"
+#include "OrtModel.h"
+#include "Preprocessing.h"
+#include "json.hpp"
+#include <onnxruntime_cxx_api.h>
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+// --- Параметры замеров ---
+const int WARMUP_RUNS = 3;
+const int BENCHMARK_RUNS = 10;
+const int DEFAULT_INPUT_SIZE = 640;
+const int SYNTHETIC_FRAMES = 8;
+
+const std::vector<std::string> OPTIMIZATION_LEVELS = {"disable", "basic", "extended", "all"};
+const std::vector<int> BATCH_SIZES = {1, 2, 4, 8};
+const std::vector<int> INPUT_SIZES = {320, 416, 512, 640};
+
+AutoTuner::AutoTuner(std::vector<cv::Mat> frames) : m_frames(std::move(frames)) {
+    if (m_frames.empty()) {
+        spdlog::info("AutoTuner: no recorded frames, using synthetic input");
+        for (int i = 0; i < SYNTHETIC_FRAMES; ++i) {
+            cv::Mat frame(480, 640, CV_8UC3);
+            cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+            m_frames.push_back(frame);
+        }
+    }
+}
+
+std::vector<cv::Mat> AutoTuner::loadFrames(const std::string& directory) {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file()) {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<cv::Mat> frames;
+    for (const auto& path : paths) {
+        cv::Mat frame = cv::imread(path.string());
+        if (!frame.empty()) {
+            frames.push_back(frame);
+        }
+    }
+    spdlog::info("AutoTuner: loaded {} frames from {}", frames.size(), directory);
+    return frames;
+}
+
+void AutoTuner::addModel(const std::string& name, const std::string& path, bool allowCuda) {
+    ModelEntry entry;
+    entry.name = name;
+    entry.path = path;
+    entry.allowCuda = allowCuda;
+    entry.config = ConfigManager::getInstance().getModelConfig(name);
+    m_models.push_back(entry);
+}
+
+double AutoTuner::measure(const ModelEntry& entry, const ModelConfig& config, int threads) const {
+    try {
+        Ort::SessionOptions sessionOptions = OrtEnvironment::getInstance().createSessionOptions(entry.name, config, entry.allowCuda, threads);
+        OrtModel model(OrtEnvironment::getInstance().getEnv(), entry.path, sessionOptions);
+
+        std::vector<int64_t> input_shape = model.inputShape();
+        int64_t batch = model.batchSize() > 0 ? model.batchSize() : std::max(1, config.batchSize);
+        input_shape[0] = batch;
+
+        // Изображения подаются как в рабочем режиме, остальные входы заполняются случайными значениями
+        if (input_shape.size() == 4) {
+            // uint8 вход в раскладке NHWC, float - в NCHW
+            size_t height_axis = model.hasUint8Input() ? 1 : 2;
+            int input_size = input_shape[height_axis] > 0 ? static_cast<int>(input_shape[height_axis])
+                : (config.inputSize > 0 ? config.inputSize : DEFAULT_INPUT_SIZE);
+            input_shape[height_axis] = input_shape[height_axis + 1] = input_size;
+
+            std::vector<cv::Mat> images;
+            for (int64_t b = 0; b < batch; ++b) {
+                images.push_back(m_frames[b % m_frames.size()]);
+            }
+            if (model.hasUint8Input()) {
+                letterboxFromImagesU8(images, cv::Size(input_size, input_size), model.prepareInput<uint8_t>(input_shape));
+            }
+            else {
+                letterboxFromImagesFused(images, cv::Size(input_size, input_size), model.prepareInput<float>(input_shape));
+            }
+        }
+        else {
+            int64_t elements = 1;
+            for (auto& dim : input_shape) {
+                if (dim <= 0) dim = 1;
+                elements *= dim;
+            }
+            cv::Mat input(1, static_cast<int>(elements), CV_32F, model.prepareInput<float>(input_shape));
+            cv::randu(input, cv::Scalar::all(-1.0), cv::Scalar::all(1.0));
+        }
+
+        for (int i = 0; i < WARMUP_RUNS; ++i) {
+            model.run();
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCHMARK_RUNS; ++i) {
+            model.run();
+        }
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return totalMs / (BENCHMARK_RUNS * batch);
+    }
+    catch (const std::exception& e) {
+        spdlog::warn("AutoTuner: {} failed (level {}, input {}, batch {}, threads {}): {}",
+            entry.name, config.optimizationLevel, config.inputSize, config.batchSize, threads, e.what());
+        return -1.0;
+    }
+}
+
+void AutoTuner::run() {
+    // Общий пул один на все модели, поэтому число потоков выбирается по суммарному времени
+    int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> thread_candidates;
+    for (int threads = 1; threads < hardware_threads; threads *= 2) {
+        thread_candidates.push_back(threads);
+    }
+    thread_candidates.push_back(hardware_threads);
+
+    double best_total = std::numeric_limits<double>::max();
+    for (int threads : thread_candidates) {
+        double total = 0.0;
+        for (const auto& entry : m_models) {
+            double latency = measure(entry, entry.config, threads);
+            total += latency >= 0.0 ? latency : std::numeric_limits<double>::max() / m_models.size();
+        }
+        spdlog::info("AutoTuner: {} intra-op threads -> {:.2f} ms per image (all models)", threads, total);
+        if (total < best_total) {
+            best_total = total;
+            m_intraOpThreads = threads;
+        }
+    }
+
+    double budgetMs = ConfigManager::getInstance().getAutotuneBudgetMs();
+    for (auto& entry : m_models) {
+        entry.latencyMs = measure(entry, entry.config, m_intraOpThreads);
+
+        for (const auto& level : OPTIMIZATION_LEVELS) {
+            ModelConfig candidate = entry.config;
+            candidate.optimizationLevel = level;
+            double latency = measure(entry, candidate, m_intraOpThreads);
+            spdlog::info("AutoTuner: {} optimization {} -> {:.2f} ms", entry.name, level, latency);
+            if (latency >= 0.0 && (entry.latencyMs < 0.0 || latency < entry.latencyMs)) {
+                entry.config = candidate;
+                entry.latencyMs = latency;
+            }
+        }
+
+        // Форма входа нужна, чтобы не перебирать то, что зафиксировано в модели
+        std::vector<int64_t> input_shape;
+        try {
+            Ort::SessionOptions sessionOptions = OrtEnvironment::getInstance().createSessionOptions(entry.name, entry.config, entry.allowCuda, m_intraOpThreads);
+            input_shape = OrtModel(OrtEnvironment::getInstance().getEnv(), entry.path, sessionOptions).inputShape();
+        }
+        catch (const std::exception& e) {
+            spdlog::error("AutoTuner: failed to load {}: {}", entry.name, e.what());
+            continue;
+        }
+
+        if (!input_shape.empty() && input_shape[0] <= 0) {
+            for (int batch : BATCH_SIZES) {
+                ModelConfig candidate = entry.config;
+                candidate.batchSize = batch;
+                double latency = measure(entry, candidate, m_intraOpThreads);
+                spdlog::info("AutoTuner: {} batch {} -> {:.2f} ms per image", entry.name, batch, latency);
+                if (latency >= 0.0 && (entry.latencyMs < 0.0 || latency < entry.latencyMs)) {
+                    entry.config = candidate;
+                    entry.latencyMs = latency;
+                }
+            }
+        }
+
+        // Меньший вход всегда быстрее, поэтому берётся наибольший, укладывающийся в бюджет
+        size_t height_axis = entry.config.inputFormat == "uint8_nhwc" ? 1 : 2;
+        if (input_shape.size() == 4 && input_shape[height_axis] <= 0) {
+            ModelConfig fastest;
+            double fastest_latency = -1.0;
+            bool fits_budget = false;
+            for (int input_size : INPUT_SIZES) {
+                ModelConfig candidate = entry.config;
+                candidate.inputSize = input_size;
+                double latency = measure(entry, candidate, m_intraOpThreads);
+                spdlog::info("AutoTuner: {} input {} -> {:.2f} ms per image", entry.name, input_size, latency);
+                if (latency < 0.0) continue;
+                if (fastest_latency < 0.0 || latency < fastest_latency) {
+                    fastest = candidate;
+                    fastest_latency = latency;
+                }
+                if (latency <= budgetMs) {
+                    entry.config = candidate;
+                    entry.latencyMs = latency;
+                    fits_budget = true;
+                }
+            }
+            if (!fits_budget && fastest_latency >= 0.0) {
+                spdlog::warn("AutoTuner: {} does not fit {:.1f} ms budget, using input {}", entry.name, budgetMs, fastest.inputSize);
+                entry.config = fastest;
+                entry.latencyMs = fastest_latency;
+            }
+        }
+
+        spdlog::info("AutoTuner: {} -> optimization {}, input {}, batch {}, {:.2f} ms per image",
+            entry.name, entry.config.optimizationLevel, entry.config.inputSize, entry.config.batchSize, entry.latencyMs);
+    }
+}
+
+void AutoTuner::save(const std::string& filepath) const {
+    nlohmann::json data;
+    data["intra_op_threads"] = m_intraOpThreads;
+    for (const auto& entry : m_models) {
+        data["models"][entry.name] = {
+            {"optimization_level", entry.config.optimizationLevel},
+            {"input_size", entry.config.inputSize},
+            {"batch_size", entry.config.batchSize},
+            {"latency_ms", entry.latencyMs}
+        };
+    }
+
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        throw std::runtime_error("AutoTuner: Failed to write profile " + filepath);
+    }
+    file << data.dump(4) << std::endl;
+    spdlog::info("AutoTuner: profile saved to {}", filepath);
+}
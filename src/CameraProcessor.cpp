@@ -2,6 +2,8 @@
 
 #include "CameraProcessor.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 
@@ -9,16 +11,13 @@ CameraProcessor::CameraProcessor(
     const CameraConfig& config,
     std::shared_ptr<SystemState> systemState,
     std::shared_ptr<HttpClient> httpClient,
-    std::shared_ptr<HumanDetector> humanDetector,
-    std::shared_ptr<GestureRecognizer> gestureRecognizer)
+    std::shared_ptr<InferenceScheduler> inferenceScheduler)
     : m_config(config),
         m_systemState(systemState),
         m_httpClient(httpClient),
-        m_humanDetector(humanDetector),
-        m_gestureRecognizer(gestureRecognizer),
+        m_inferenceScheduler(inferenceScheduler),
         m_isRunning(true),
-        m_lastDetectedGesture(GestureType::NONE),
-        m_gestureCounter(0) {
+        m_motionGate(config.motionThreshold, std::chrono::milliseconds(config.motionKeepAliveMs)) {
 
     
     int cooldownSec=5;
@@ -29,6 +28,10 @@ CameraProcessor::CameraProcessor(
 
 void CameraProcessor::stop(){
     m_isRunning.store(false);
+    // Стадии, ждущие очередей, проверяют флаг и завершаются
+    for (auto* queue : {&m_captureQueue, &m_preprocessQueue, &m_detectQueue, &m_recognizeQueue}) {
+        queue->wakeAll();
+    }
 }
 
 cv::Mat CameraProcessor::getLatestFrame() {
@@ -36,6 +39,98 @@ cv::Mat CameraProcessor::getLatestFrame() {
     return m_latestFrame.clone();
 }
 
+namespace {
+    // Неподвижность человека для повторного использования позы:
+    // сдвиг центра и изменение размеров рамки - в долях рамки позы
+    const double POSE_MAX_SHIFT = 0.05;
+    const double POSE_MAX_RESIZE = 0.1;
+    // Доля пикселей уменьшенного выреза, изменившихся больше чем на POSE_PIXEL_THRESHOLD
+    const cv::Size POSE_THUMBNAIL_SIZE(32, 64);
+    const int POSE_PIXEL_THRESHOLD = 25;
+    const double POSE_MAX_CHANGED_FRACTION = 0.02;
+
+    // Жест подтверждается по свидетельствам, накопленным во времени: каждый кадр вносит
+    // логарифм отношения вероятности кандидата к лучшему из остальных классов (не больше
+    // GESTURE_MAX_FRAME_EVIDENCE по модулю), умноженный на интервал до предыдущего кадра
+    // (не больше GESTURE_MAX_FRAME_INTERVAL). Кадр, на котором кандидат появился, тоже считается,
+    // кроме первого кадра трека или кадра после перерыва: его интервал неизвестен.
+    // Нужно не меньше GESTURE_MIN_OBSERVATIONS кадров кандидата, поэтому один уверенный кадр жест не подтверждает.
+    // Уверенный жест (p >= 0.9) подтверждается примерно за 0.2 с при 30 кадрах в секунду
+    // и за 2-3 кадра при 5-10, неоднозначный (p = 0.45 против 0.15) - примерно за полсекунды
+    const double GESTURE_EVIDENCE_THRESHOLD = 0.6;
+    const double GESTURE_MAX_FRAME_EVIDENCE = 4.0;
+    const int GESTURE_MIN_OBSERVATIONS = 2;
+    // Наибольший интервал, за который говорит один кадр, секунды
+    const double GESTURE_MAX_FRAME_INTERVAL = 0.2;
+    // После такого перерыва в распознавании кандидат забывается, секунды
+    const double GESTURE_MAX_GAP = 1.0;
+    // Выполненный жест повторяется, только если модель не видела его столько секунд:
+    // удерживаемый жест срабатывает один раз
+    const double GESTURE_REPEAT_DELAY = 1.0;
+
+    double frameEvidence(const RecognitionResult& result, GestureType gesture) {
+        size_t index = static_cast<size_t>(gesture);
+        if (index >= result.gestureProbabilities.size()) {
+            return result.finalGesture == gesture ? GESTURE_MAX_FRAME_EVIDENCE : -GESTURE_MAX_FRAME_EVIDENCE;
+        }
+        float rival = 0.0f;
+        for (size_t i = 0; i < result.gestureProbabilities.size(); ++i) {
+            if (i != index) rival = std::max(rival, result.gestureProbabilities[i]);
+        }
+        double ratio = std::max(result.gestureProbabilities[index], 1e-6f) / std::max(rival, 1e-6f);
+        return std::clamp(std::log(ratio), -GESTURE_MAX_FRAME_EVIDENCE, GESTURE_MAX_FRAME_EVIDENCE);
+    }
+
+    // Возвращает true, если жест кандидата подтверждён
+    bool accumulateEvidence(TrackGestureState& state, const RecognitionResult& result, std::chrono::steady_clock::time_point at) {
+        double elapsed = std::chrono::duration<double>(at - state.evidenceUpdatedAt).count();
+        state.evidenceUpdatedAt = at;
+        double weight = std::clamp(elapsed, 0.0, GESTURE_MAX_FRAME_INTERVAL);
+
+        if (elapsed < 0.0 || elapsed > GESTURE_MAX_GAP) {
+            state.lastGesture = GestureType::NONE;
+            state.evidence = 0.0;
+            state.observations = 0;
+            weight = 0.0;
+        }
+
+        // Пока выполненный жест виден, он не может стать кандидатом снова
+        GestureType predicted = result.finalGesture;
+        if (state.repeatBlocked != GestureType::NONE
+            && std::chrono::duration<double>(at - state.repeatBlockedAt).count() >= GESTURE_REPEAT_DELAY) {
+            state.repeatBlocked = GestureType::NONE;
+        }
+        if (predicted != GestureType::NONE && predicted == state.repeatBlocked) {
+            state.repeatBlockedAt = at;
+            predicted = GestureType::NONE;
+        }
+
+        if (state.lastGesture != GestureType::NONE) {
+            state.evidence += frameEvidence(result, state.lastGesture) * weight;
+            ++state.observations;
+        }
+        // Кандидат опровергнут - им становится текущее предсказание, его кадр уже идёт в зачёт
+        if (state.evidence <= 0.0) {
+            state.lastGesture = predicted;
+            state.evidence = predicted == GestureType::NONE
+                ? 0.0
+                : std::max(0.0, frameEvidence(result, predicted) * weight);
+            state.observations = predicted == GestureType::NONE ? 0 : 1;
+        }
+        return state.lastGesture != GestureType::NONE
+            && state.observations >= GESTURE_MIN_OBSERVATIONS
+            && state.evidence >= GESTURE_EVIDENCE_THRESHOLD;
+    }
+
+    cv::Mat poseThumbnail(const cv::Mat& crop) {
+        cv::Mat small;
+        cv::Mat gray;
+        cv::resize(crop, small, POSE_THUMBNAIL_SIZE, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+        return gray;
+    }
+}
+
 void CameraProcessor::run(){
     spdlog::info("Starting processor for camera ID: {}", m_config.id);
   
@@ -54,107 +149,349 @@ void CameraProcessor::run(){
         return;
     }
 
-    cv::Mat frame;
+    std::vector<std::thread> stages;
+    stages.emplace_back(&CameraProcessor::preprocessLoop, this);
+    stages.emplace_back(&CameraProcessor::detectLoop, this);
+    stages.emplace_back(&CameraProcessor::recognizeLoop, this);
+    stages.emplace_back(&CameraProcessor::actionLoop, this);
+
+    captureLoop(cap);
+
+    stop();
+    for (auto& stage : stages) {
+        if (stage.joinable()) {
+            stage.join();
+        }
+    }
+
+    spdlog::info("Stopping processor for camera  ID: {}", m_config.id);
+}
+
+void CameraProcessor::captureLoop(cv::VideoCapture& cap) {
     while (m_isRunning.load()){ 
         if (!ConfigManager::getInstance().isWorkTime()){ 
             std::this_thread::sleep_for(std::chrono::seconds(60));
             continue;
         }
-        if (!cap.read(frame) || frame.empty()){
+        FramePacket packet;
+        if (!cap.read(packet.frame) || packet.frame.empty()){
             spdlog::error("Camera ID {} connection lost", m_config.id);
             std::this_thread::sleep_for(std::chrono::seconds(5)); 
             cap.open(m_config.videoUrl);
             continue;
         }
-        cv::flip(frame, frame, 1);
-        processFrame(frame);
-        {
-            
-            std::lock_guard<std::mutex> lock(m_frameMutex);
-            m_latestFrame = frame.clone();
-        }
-        
+        packet.capturedAt = std::chrono::steady_clock::now();
+        // Если конвейер не успевает, кадр отбрасывается, чтобы не копить задержку
+        m_captureQueue.tryPush(std::move(packet));
+    }
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+void CameraProcessor::preprocessLoop() {
+    FramePacket packet;
+    while (m_captureQueue.waitPop(packet, m_isRunning)) {
+        cv::flip(packet.frame, packet.frame, 1);
+        packet.roiRect = cv::Rect(m_config.roi[0], m_config.roi[1], m_config.roi[2], m_config.roi[3]);
+        packet.roiFrame = packet.frame(packet.roiRect);
+        packet.motionSkipped = !m_motionGate.shouldRun(packet.roiFrame, m_gestureCandidate.load());
+        m_preprocessQueue.waitPush(std::move(packet), m_isRunning);
     }
+}
 
-    spdlog::info("Stopping processor for camera  ID: {}", m_config.id);
+void CameraProcessor::detectLoop() {
+    FramePacket packet;
+    while (m_preprocessQueue.waitPop(packet, m_isRunning)) {
+        // Не ждём результата: пока идёт инференс, стадия отправляет следующие кадры
+        if (packet.motionSkipped) {
+            // Кадр без движения проходит конвейер только для отображения
+        }
+        else if (m_config.singlePass) {
+            packet.pendingPoses = m_inferenceScheduler->submitPoses(m_config.id, packet.roiFrame);
+        }
+        else {
+            auto now = std::chrono::steady_clock::now();
+            bool forced = m_forceKeyframe.exchange(false);
+            if (forced || m_config.detectFps <= 0.0 || now - m_lastKeyframe >= std::chrono::duration<double>(1.0 / m_config.detectFps)) {
+                packet.pendingDetections = m_inferenceScheduler->submitDetect(m_config.id, packet.roiFrame);
+                m_lastKeyframe = now;
+            }
+        }
+        m_detectQueue.waitPush(std::move(packet), m_isRunning);
+    }
 }
 
+// Кадры, пропущенные затвором движения, сюда не попадают, но пока у трека есть кандидат
+// на жест, стадия действий держит затвор открытым (m_gestureCandidate)
+std::vector<size_t> CameraProcessor::selectForRecognition(const std::vector<int>& trackIds) {
+    std::vector<size_t> selected;
+    std::unordered_map<int, int> framesSinceRecognition;
+    std::lock_guard<std::mutex> lock(m_trackStateMutex);
+    for (size_t i = 0; i < trackIds.size(); ++i) {
+        int trackId = trackIds[i];
+        auto frames = m_framesSinceRecognition.find(trackId);
+        // Новый человек распознаётся сразу
+        int framesSince = frames == m_framesSinceRecognition.end() ? IDLE_RECOGNITION_INTERVAL : frames->second + 1;
+        auto state = m_trackStates.find(trackId);
+        bool candidate = state != m_trackStates.end() && state->second.lastGesture != GestureType::NONE;
+        if (candidate || framesSince >= IDLE_RECOGNITION_INTERVAL) {
+            selected.push_back(i);
+            framesSince = 0;
+        }
+        framesSinceRecognition[trackId] = framesSince;
+    }
+    // Ушедшие треки забываются
+    m_framesSinceRecognition = std::move(framesSinceRecognition);
+    return selected;
+}
 
-void CameraProcessor::processFrame(cv::Mat& frame) {
-    cv::Rect roiRect(m_config.roi[0], m_config.roi[1], m_config.roi[2], m_config.roi[3]);
-    cv::rectangle(frame, roiRect, cv::Scalar(255, 255, 0), 2);
-    cv::Mat roiFrame = frame(roiRect);
-
-    auto detections = m_humanDetector->detect(roiFrame);
-    bool humanFound = !detections.empty();
-    bool gestureConfirmedThisFrame = false;
-
-    if (humanFound) {
-        for (auto humanRect : detections) {
-            humanRect &= cv::Rect(0, 0, roiFrame.cols, roiFrame.rows);
-            if (humanRect.width <= 0 || humanRect.height <= 0) continue;
-            
-            cv::Rect absoluteRect = humanRect + cv::Point(roiRect.x, roiRect.y);
-            //cv::rectangle(frame, absoluteRect, cv::Scalar(0, 255, 0), 2);
-            
-            cv::Mat personFrame = roiFrame(humanRect);
-
-            RecognitionResult result = m_gestureRecognizer->recognize(personFrame);
-            GestureType currentGesture = result.finalGesture;
-
-
-            // Отрисовка точек
-            /*
-            cv::Point2f total_offset = (cv::Point2f)absoluteRect.tl();
-            // Точки позы
-            for (const auto& kp : result.poseKeypoints) {
-                if (kp.confidence > 0.5) {
-                    cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(255, 0, 0), -1);
+bool CameraProcessor::reusablePose(int trackId, const cv::Mat& roiFrame, const cv::Rect& humanRect,
+    std::vector<Keypoint>& keypoints, cv::Rect& poseRect) {
+    cv::Mat thumbnail;
+    {
+        std::lock_guard<std::mutex> lock(m_trackStateMutex);
+        auto state = m_trackStates.find(trackId);
+        if (state == m_trackStates.end() || state->second.poseKeypoints.empty()) return false;
+        if (std::chrono::steady_clock::now() - state->second.poseRefreshedAt >= POSE_REFRESH_INTERVAL) return false;
+        keypoints = state->second.poseKeypoints;
+        poseRect = state->second.poseRect;
+        thumbnail = state->second.poseThumbnail;
+    }
+
+    // Рамка почти не сдвинулась
+    cv::Point2d shift = (cv::Point2d(humanRect.tl()) + cv::Point2d(humanRect.br())) * 0.5
+        - (cv::Point2d(poseRect.tl()) + cv::Point2d(poseRect.br())) * 0.5;
+    if (std::abs(shift.x) > POSE_MAX_SHIFT * poseRect.width || std::abs(shift.y) > POSE_MAX_SHIFT * poseRect.height) return false;
+    if (std::abs(humanRect.width - poseRect.width) > POSE_MAX_RESIZE * poseRect.width) return false;
+    if (std::abs(humanRect.height - poseRect.height) > POSE_MAX_RESIZE * poseRect.height) return false;
+
+    // И внутри выреза ничего не двигается (например, рука)
+    cv::Rect roiBounds(0, 0, roiFrame.cols, roiFrame.rows);
+    if ((poseRect & roiBounds) != poseRect) return false;
+    cv::Mat diff;
+    cv::absdiff(poseThumbnail(roiFrame(poseRect)), thumbnail, diff);
+    int changed = cv::countNonZero(diff > POSE_PIXEL_THRESHOLD);
+    return changed <= POSE_MAX_CHANGED_FRACTION * diff.total();
+}
+
+void CameraProcessor::recognizeLoop() {
+    FramePacket packet;
+    while (m_detectQueue.waitPop(packet, m_isRunning)) {
+        cv::Rect roiBounds(0, 0, packet.roiFrame.cols, packet.roiFrame.rows);
+        std::vector<std::vector<Keypoint>> poses;
+        if (packet.pendingPoses.valid()) {
+            try {
+                // Рамки модели позы определяют присутствие, её точки сразу идут в классификацию
+                for (auto& instance : packet.pendingPoses.get()) {
+                    cv::Rect humanRect = cv::Rect(instance.box) & roiBounds;
+                    if (humanRect.width <= 0 || humanRect.height <= 0) continue;
+                    packet.detections.push_back(humanRect);
+                    poses.push_back(std::move(instance.keypoints));
                 }
+                packet.trackIds = m_tracker.update(packet.roiFrame, packet.detections);
+            }
+            catch (const std::exception& e) {
+                spdlog::error("Camera ID {} | Pose detection failed: {}", m_config.id, e.what());
+                packet.detections.clear();
+                packet.inferenceFailed = true;
             }
-            // Точки левой руки
-            for (const auto& kp : result.leftHandKeypoints) {
-                if (kp.confidence > 0.5) {
-                    cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(0, 255, 0), -1);
+        }
+        else if (!packet.motionSkipped) {
+            if (packet.pendingDetections.valid()) {
+                try {
+                    m_tracker.update(packet.roiFrame, packet.pendingDetections.get());
                 }
+                catch (const std::exception& e) {
+                    spdlog::error("Camera ID {} | Detection failed: {}", m_config.id, e.what());
+                    packet.inferenceFailed = true;
+                    m_forceKeyframe.store(true);
+                }
+            }
+            else if (m_tracker.propagate(packet.roiFrame) < MIN_TRACK_CONFIDENCE) {
+                m_forceKeyframe.store(true);
             }
-            // Точки правой руки
-            for (const auto& kp : result.rightHandKeypoints) {
-                if (kp.confidence > 0.5) {
-                    cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(0, 0, 255), -1);
+            // Треки, не подтверждённые последним ключевым кадром, в присутствие не идут
+            if (!packet.inferenceFailed) {
+                for (const auto& track : m_tracker.tracks()) {
+                    if (track.misses > 0) continue;
+                    cv::Rect humanRect = cv::Rect(track.box) & roiBounds;
+                    if (humanRect.width <= 0 || humanRect.height <= 0) continue;
+                    packet.detections.push_back(humanRect);
+                    packet.trackIds.push_back(track.id);
                 }
             }
-            */
-            if (currentGesture == m_lastDetectedGesture && currentGesture != GestureType::NONE) {
-                m_gestureCounter++;
-            } else {
-                m_gestureCounter = 1;
-                m_lastDetectedGesture = currentGesture;
+        }
+
+        if (!packet.motionSkipped && !packet.inferenceFailed) {
+            std::vector<size_t> selected = selectForRecognition(packet.trackIds);
+
+            if (!selected.empty() && m_config.singlePass) {
+                std::vector<std::vector<Keypoint>> selectedPoses;
+                selectedPoses.reserve(selected.size());
+                for (size_t index : selected) {
+                    packet.recognizedTracks.push_back(packet.trackIds[index]);
+                    packet.recognizedRects.push_back(packet.detections[index]);
+                    packet.reusedPoses.push_back(false);
+                    selectedPoses.push_back(std::move(poses[index]));
+                }
+                packet.pendingResults = m_inferenceScheduler->submitRecognize(m_config.id, packet.roiFrame, std::move(selectedPoses));
             }
+            else if (!selected.empty()) {
+                // Неподвижные люди распознаются по позе с прошлых кадров, без модели позы
+                std::vector<cv::Mat> personFrames;
+                std::vector<cv::Mat> reusedFrames;
+                std::vector<std::vector<Keypoint>> reusedPoses;
+                std::vector<int> reusedTracks;
+                std::vector<cv::Rect> reusedRects;
+                for (size_t index : selected) {
+                    int trackId = packet.trackIds[index];
+                    std::vector<Keypoint> keypoints;
+                    cv::Rect poseRect;
+                    if (reusablePose(trackId, packet.roiFrame, packet.detections[index], keypoints, poseRect)) {
+                        reusedFrames.push_back(packet.roiFrame(poseRect));
+                        reusedPoses.push_back(std::move(keypoints));
+                        reusedTracks.push_back(trackId);
+                        reusedRects.push_back(poseRect);
+                    }
+                    else {
+                        personFrames.push_back(packet.roiFrame(packet.detections[index]));
+                        packet.recognizedTracks.push_back(trackId);
+                        packet.recognizedRects.push_back(packet.detections[index]);
+                        packet.reusedPoses.push_back(false);
+                    }
+                }
+                packet.recognizedTracks.insert(packet.recognizedTracks.end(), reusedTracks.begin(), reusedTracks.end());
+                packet.recognizedRects.insert(packet.recognizedRects.end(), reusedRects.begin(), reusedRects.end());
+                packet.reusedPoses.insert(packet.reusedPoses.end(), reusedTracks.size(), true);
 
-            if (m_gestureCounter >= GESTURE_CONFIRMATION_FRAMES) {
-                spdlog::info("Camera ID {} | Gesture {} CONFIRMED.", m_config.id, static_cast<int>(currentGesture));
-                handleGesture(currentGesture);
-                
-                m_gestureCounter = 0;
-                m_lastDetectedGesture = GestureType::NONE;
-                gestureConfirmedThisFrame = true;
-                break;
+                // Остальные выбранные люди кадра распознаются одним батчем
+                if (!personFrames.empty()) {
+                    packet.pendingResults = m_inferenceScheduler->submitRecognize(m_config.id, std::move(personFrames));
+                }
+                if (!reusedPoses.empty()) {
+                    packet.pendingReusedResults = m_inferenceScheduler->submitRecognize(
+                        m_config.id, std::move(reusedFrames), std::move(reusedPoses));
+                }
             }
         }
-    } else {
-        m_gestureCounter = 0;
-        m_lastDetectedGesture = GestureType::NONE;
+        m_recognizeQueue.waitPush(std::move(packet), m_isRunning);
     }
+}
+
+void CameraProcessor::actionLoop() {
+    FramePacket packet;
+    while (m_recognizeQueue.waitPop(packet, m_isRunning)) {
+        try {
+            if (packet.pendingResults.valid()) {
+                packet.results = packet.pendingResults.get();
+            }
+            if (packet.pendingReusedResults.valid()) {
+                auto reused = packet.pendingReusedResults.get();
+                packet.results.insert(packet.results.end(), std::make_move_iterator(reused.begin()), std::make_move_iterator(reused.end()));
+            }
+        }
+        catch (const std::exception& e) {
+            spdlog::error("Camera ID {} | Gesture recognition failed: {}", m_config.id, e.what());
+            packet.results.clear();
+            packet.inferenceFailed = true;
+        }
+        // Уменьшенные вырезы для свежих поз считаются до блокировки
+        std::vector<cv::Mat> thumbnails(packet.results.size());
+        for (size_t i = 0; i < packet.results.size(); ++i) {
+            if (!m_config.singlePass && !packet.reusedPoses[i] && !packet.results[i].poseKeypoints.empty()) {
+                thumbnails[i] = poseThumbnail(packet.roiFrame(packet.recognizedRects[i]));
+            }
+        }
+        cv::Mat& frame = packet.frame;
+        const cv::Rect& roiRect = packet.roiRect;
+        bool humanFound = !packet.inferenceFailed && !packet.detections.empty();
+        bool gestureConfirmedThisFrame = false;
+        GestureType confirmedGesture = GestureType::NONE;
+
+        if (packet.motionSkipped || packet.inferenceFailed) {
+            // Сцена не изменилась или инференс не удался: счётчики подтверждения жестов и присутствие не трогаем
+        }
+        else {
+            std::lock_guard<std::mutex> lock(m_trackStateMutex);
+            // Состояние ушедших людей сбрасывается
+            for (auto it = m_trackStates.begin(); it != m_trackStates.end();) {
+                bool present = std::find(packet.trackIds.begin(), packet.trackIds.end(), it->first) != packet.trackIds.end();
+                it = present ? std::next(it) : m_trackStates.erase(it);
+            }
+
+            for (size_t i = 0; i < packet.results.size(); ++i) {
+                const RecognitionResult& result = packet.results[i];
+
+                //cv::Rect absoluteRect = packet.detections[i] + cv::Point(roiRect.x, roiRect.y);
+                //cv::rectangle(frame, absoluteRect, cv::Scalar(0, 255, 0), 2);
+
+                // Отрисовка точек
+                /*
+                cv::Point2f total_offset = (cv::Point2f)absoluteRect.tl();
+                // Точки позы
+                for (const auto& kp : result.poseKeypoints) {
+                    if (kp.confidence > 0.5) {
+                        cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(255, 0, 0), -1);
+                    }
+                }
+                // Точки левой руки
+                for (const auto& kp : result.leftHandKeypoints) {
+                    if (kp.confidence > 0.5) {
+                        cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(0, 255, 0), -1);
+                    }
+                }
+                // Точки правой руки
+                for (const auto& kp : result.rightHandKeypoints) {
+                    if (kp.confidence > 0.5) {
+                        cv::circle(frame, kp.point + total_offset, 3, cv::Scalar(0, 0, 255), -1);
+                    }
+                }
+                */
+                int trackId = packet.recognizedTracks[i];
+                TrackGestureState& state = m_trackStates[trackId];
+                if (!thumbnails[i].empty()) {
+                    state.poseKeypoints = result.poseKeypoints;
+                    state.poseRect = packet.recognizedRects[i];
+                    state.poseThumbnail = thumbnails[i];
+                    state.poseRefreshedAt = std::chrono::steady_clock::now();
+                }
+                // Свидетельства обновляются у всех треков кадра; за кадр выполняется один жест,
+                // подтверждение другого трека остаётся над порогом до следующего кадра
+                bool confirmed = accumulateEvidence(state, result, packet.capturedAt);
+                if (confirmed && !gestureConfirmedThisFrame) {
+                    confirmedGesture = state.lastGesture;
+                    spdlog::info("Camera ID {} | Track {} | Gesture {} CONFIRMED (evidence {:.2f}).",
+                        m_config.id, trackId, static_cast<int>(confirmedGesture), state.evidence);
+                    state.lastGesture = GestureType::NONE;
+                    state.evidence = 0.0;
+                    state.observations = 0;
+                    state.repeatBlocked = confirmedGesture;
+                    state.repeatBlockedAt = packet.capturedAt;
+                    gestureConfirmedThisFrame = true;
+                }
+            }
+
+            m_gestureCandidate.store(std::any_of(m_trackStates.begin(), m_trackStates.end(), [](const auto& entry) {
+                return entry.second.lastGesture != GestureType::NONE;
+            }));
+        }
+
+        // Запрос отправляется вне блокировки, чтобы не задерживать стадию распознавания
+        if (gestureConfirmedThisFrame) {
+            handleGesture(confirmedGesture);
+        }
 
-    if (humanFound && !gestureConfirmedThisFrame && m_systemState->getMode() == SystemMode::AUTO) {
-        auto now = std::chrono::steady_clock::now();
-        if (now > m_lastRequestTime + m_cooldownDuration) {
-            spdlog::info("Camera ID {} | Human detected, no gesture. Sending light ON.", m_config.id);
-            m_httpClient->sendGetRequest(m_config.APIUrl); 
-            m_lastRequestTime = now;
+        if (humanFound && !gestureConfirmedThisFrame && m_systemState->getMode() == SystemMode::AUTO) {
+            auto now = std::chrono::steady_clock::now();
+            if (now > m_lastRequestTime + m_cooldownDuration) {
+                spdlog::info("Camera ID {} | Human detected, no gesture. Sending light ON.", m_config.id);
+                m_httpClient->sendGetRequest(m_config.APIUrl); 
+                m_lastRequestTime = now;
+            }
+        }
+
+        cv::rectangle(frame, roiRect, cv::Scalar(255, 255, 0), 2);
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            m_latestFrame = frame;
         }
     }
 }
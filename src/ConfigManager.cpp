@@ -41,10 +41,39 @@ void ConfigManager::load(const std::string& filepath){
             config.videoUrl = camJson.at("video_url").get<std::string>();
             config.APIUrl = camJson.at("APIUrl").get<std::string>();
             config.roi = camJson.at("roi").get<std::vector<int>>();
+            config.weight = camJson.value("weight", 1);
+            config.singlePass = camJson.value("single_pass", false);
+            config.motionThreshold = camJson.value("motion_threshold", 0.0);
+            config.motionKeepAliveMs = camJson.value("motion_keepalive_ms", 1000);
+            config.detectFps = camJson.value("detect_fps", 0.0);
             m_device = data.at("general").at("device").get<std::string>();
             m_cameraConfigs.push_back(config);
         } 
 
+        const auto& generalJson = data.at("general");
+        m_detectorBatchSize = generalJson.value("detector_batch_size", 8);
+        m_detectorBatchTimeout = std::chrono::milliseconds(generalJson.value("detector_batch_timeout_ms", 5));
+        m_threadingConfig.intraOpThreads = generalJson.value("intra_op_threads", 0);
+        m_threadingConfig.interOpThreads = generalJson.value("inter_op_threads", 1);
+        m_threadingConfig.allowSpinning = generalJson.value("allow_spinning", false);
+        m_schedulerWorkers = generalJson.value("scheduler_workers", 1);
+        m_autotuneBudgetMs = generalJson.value("autotune_budget_ms", 10.0);
+
+        m_modelConfigs.clear();
+        if (data.contains("models")) {
+            const auto& modelsJson = data.at("models");
+            for (auto it = modelsJson.begin(); it != modelsJson.end(); ++it){
+                ModelConfig modelConfig;
+                modelConfig.replicas = it.value().value("replicas", 1);
+                modelConfig.pinnedCameras = it.value().value("pinned_cameras", std::vector<int>{});
+                modelConfig.optimizationLevel = it.value().value("optimization_level", std::string("all"));
+                modelConfig.inputSize = it.value().value("input_size", 0);
+                modelConfig.batchSize = it.value().value("batch_size", 0);
+                modelConfig.inputFormat = it.value().value("input_format", std::string("float_nchw"));
+                m_modelConfigs[it.key()] = modelConfig;
+            }
+        }
+
         m_gestureActions.clear();
         const auto& gesturesJson = data.at("gesture_actions");
         for (auto it = gesturesJson.begin(); it != gesturesJson.end(); ++it){
@@ -60,10 +89,66 @@ void ConfigManager::load(const std::string& filepath){
     }
 }
 
+bool ConfigManager::loadTuningProfile(const std::string& filepath){
+    std::ifstream file(filepath);
+    if (!file.is_open()){
+        return false;
+    }
+
+    nlohmann::json data;
+    file >> data;
+
+    try {
+        m_threadingConfig.intraOpThreads = data.value("intra_op_threads", m_threadingConfig.intraOpThreads);
+        if (data.contains("models")) {
+            const auto& modelsJson = data.at("models");
+            for (auto it = modelsJson.begin(); it != modelsJson.end(); ++it){
+                // Реплики и закрепление остаются из основной конфигурации
+                ModelConfig& modelConfig = m_modelConfigs[it.key()];
+                modelConfig.optimizationLevel = it.value().value("optimization_level", modelConfig.optimizationLevel);
+                modelConfig.inputSize = it.value().value("input_size", modelConfig.inputSize);
+                modelConfig.batchSize = it.value().value("batch_size", modelConfig.batchSize);
+            }
+        }
+    }
+    catch  (const std::exception& e){
+        throw std::runtime_error("ConfigManager: Error processing tuning profile: " + std::string(e.what()));
+    }
+    return true;
+}
+
 const std::string& ConfigManager::getDevice() const {
     return m_device;
 }
 
+int ConfigManager::getDetectorBatchSize() const {
+    return m_detectorBatchSize;
+}
+
+std::chrono::milliseconds ConfigManager::getDetectorBatchTimeout() const {
+    return m_detectorBatchTimeout;
+}
+
+const OrtThreadingConfig& ConfigManager::getThreadingConfig() const {
+    return m_threadingConfig;
+}
+
+int ConfigManager::getSchedulerWorkers() const {
+    return m_schedulerWorkers;
+}
+
+ModelConfig ConfigManager::getModelConfig(const std::string& modelName) const {
+    auto it = m_modelConfigs.find(modelName);
+    if (it != m_modelConfigs.end()){
+        return it->second;
+    }
+    return ModelConfig{};
+}
+
+double ConfigManager::getAutotuneBudgetMs() const {
+    return m_autotuneBudgetMs;
+}
+
 bool ConfigManager::isWorkTime() const{
     const auto now = std::chrono::system_clock::now();
     const std::time_t t_c = std::chrono::system_clock::to_time_t(now);
@@ -1,13 +1,20 @@
 #include "GestureRecognizer.h"
 #include <onnxruntime_cxx_api.h>
-#include <opencv2/dnn.hpp>
 #include "spdlog/spdlog.h"
 #include "ConfigManager.h"
+#include "Preprocessing.h"
+#include "YoloDecoder.h"
+#include "Nms.h"
+#include <algorithm>
+#include <utility>
 
 // Параметры модели
-const int INPUT_WIDTH = 640;
-const int INPUT_HEIGHT = 640;
+// Размер входа по умолчанию для моделей с динамическим входом
+const int DEFAULT_INPUT_SIZE = 640;
 const float CONFIDENCE_THRESHOLD = 0.5f;
+// Подавление повторных предложений одного человека в модели позы
+const float POSE_NMS_THRESHOLD = 0.45f;
+const size_t MAX_POSE_INSTANCES = 20;
 
 enum BodyParts {
     LEFT_SHOULDER = 5, RIGHT_SHOULDER = 6, LEFT_ELBOW = 7, RIGHT_ELBOW = 8,
@@ -87,29 +94,12 @@ std::vector<float> normalizeYoloLandmarks(
     for(const auto& kp : rh_kps) { result.push_back(kp.point.x); result.push_back(kp.point.y); }
     return result;
 }
-std::vector<Keypoint> extractKeypointsFromModel(
-    const Ort::Value& tensor, int num_keypoints, float x_factor, float y_factor, float roi_x = 0, float roi_y = 0) 
+// Точки предложения proposal: после рамки и оценки идут num_keypoints троек (x, y, conf)
+static std::vector<Keypoint> decodeKeypoints(
+    const float* raw_output, int num_proposals, int proposal, int num_keypoints, const LetterboxTransform& transform)
 {
     std::vector<Keypoint> keypoints(num_keypoints, {cv::Point2f(0,0), 0.0f});
-    const float* raw_output = tensor.GetTensorData<float>();
-    auto shape = tensor.GetTensorTypeAndShapeInfo().GetShape();
-    int num_proposals = shape[2];
-    
-    if (num_proposals == 0) return keypoints;
-
-    int best_proposal_idx = -1;
-    float max_conf = 0.0f;
-    for (int i = 0; i < num_proposals; ++i) {
-        float conf = raw_output[4 * num_proposals + i];
-        if (conf > max_conf) {
-            max_conf = conf;
-            best_proposal_idx = i;
-        }
-    }
-
-    if (max_conf < CONFIDENCE_THRESHOLD) return keypoints;
-
-    const float* kps_data = raw_output + 5 * num_proposals + best_proposal_idx;
+    const float* kps_data = raw_output + 5 * num_proposals + proposal;
     for (int i = 0; i < num_keypoints; ++i) {
         float x = kps_data[i * 3 * num_proposals];
         float y = kps_data[(i * 3 + 1) * num_proposals];
@@ -119,7 +109,7 @@ std::vector<Keypoint> extractKeypointsFromModel(
         
         if (visible_conf > 0.5f) {
             keypoints[i] = {
-                cv::Point2f((x * x_factor) + roi_x, (y * y_factor) + roi_y),
+                transform.toSource(cv::Point2f(x, y)),
                 visible_conf
             };
         }
@@ -127,16 +117,99 @@ std::vector<Keypoint> extractKeypointsFromModel(
     return keypoints;
 }
 
-GestureRecognizer::GestureRecognizer() {
-    m_bodyPoseEnv = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "body-pose");
-    m_bodyPoseSessionOptions = std::make_unique<Ort::SessionOptions>();
-    
-    m_handPoseEnv = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "hand-pose");
-    m_handPoseSessionOptions = std::make_unique<Ort::SessionOptions>();
-    
-    m_classifierEnv = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "classifier");
-    m_classifierSessionOptions = std::make_unique<Ort::SessionOptions>();
+std::vector<Keypoint> extractKeypointsFromModel(
+    const float* raw_output, int num_proposals, int num_keypoints, const LetterboxTransform& transform) 
+{
+    if (num_proposals == 0) return std::vector<Keypoint>(num_keypoints, {cv::Point2f(0,0), 0.0f});
+
+    int best_proposal_idx = -1;
+    float max_conf = 0.0f;
+    for (int i = 0; i < num_proposals; ++i) {
+        float conf = raw_output[4 * num_proposals + i];
+        if (conf > max_conf) {
+            max_conf = conf;
+            best_proposal_idx = i;
+        }
+    }
+
+    if (max_conf < CONFIDENCE_THRESHOLD) return std::vector<Keypoint>(num_keypoints, {cv::Point2f(0,0), 0.0f});
+
+    return decodeKeypoints(raw_output, num_proposals, best_proposal_idx, num_keypoints, transform);
+}
+
+// Все люди из одного выхода YOLO-pose: предложения выше порога, NMS по рамкам,
+// не больше max_instances экземпляров в порядке убывания оценки
+std::vector<PoseInstance> extractPoseInstancesFromModel(
+    const float* raw_output, int num_proposals, int num_keypoints, const LetterboxTransform& transform, size_t max_instances)
+{
+    thread_local std::vector<cv::Rect2f> boxes;
+    thread_local std::vector<float> scores;
+    thread_local std::vector<int> kept;
+    auto candidates = decodeYoloClass(raw_output, num_proposals, 1, 0, CONFIDENCE_THRESHOLD);
+    boxes.clear();
+    scores.clear();
+    for (const auto& candidate : candidates) {
+        boxes.push_back(candidate.box);
+        scores.push_back(candidate.score);
+    }
+    nmsBoxes(boxes, scores, CONFIDENCE_THRESHOLD, POSE_NMS_THRESHOLD, kept, max_instances);
+
+    std::vector<PoseInstance> instances;
+    instances.reserve(kept.size());
+    for (int idx : kept) {
+        const Detection& candidate = candidates[idx];
+        instances.push_back({
+            transform.toSource(candidate.box),
+            candidate.score,
+            decodeKeypoints(raw_output, num_proposals, candidate.proposal, num_keypoints, transform)
+        });
+    }
+    return instances;
+}
+
+// Прогон YOLO-pose модели на наборе изображений.
+// Изображения режутся на части по размеру батча пула (неполная часть дополняется в prepareImages), decode(выход изображения, число предложений, преобразование)
+// разбирает выход каждого изображения в координатах изображения.
+template <typename Decode>
+auto runPoseModelWith(SessionPool& pool, int cameraId, int input_size, const std::vector<cv::Mat>& images, Decode decode)
+{
+    std::vector<decltype(decode(nullptr, 0, LetterboxTransform{}))> results;
+    results.reserve(images.size());
+
+    auto lease = pool.checkout(cameraId);
+    OrtModel& model = *lease;
+    size_t chunk_size = pool.batchSize() > 0 ? static_cast<size_t>(pool.batchSize()) : images.size();
+    for (size_t offset = 0; offset < images.size(); offset += chunk_size) {
+        size_t count = std::min(chunk_size, images.size() - offset);
+        std::vector<cv::Mat> chunk(images.begin() + offset, images.begin() + offset + count);
+
+        // Подготовка пишет прямо в привязанный входной тензор, вырез вписывается без искажения
+        auto transforms = pool.prepareImages(model, chunk, cv::Size(input_size, input_size));
+
+        model.run();
+        const float* raw_output = model.outputData<float>(0);
+        auto shape = model.outputShape(0);
+        int proposal_length = shape[1];
+        int num_proposals = shape[2];
+
+        for (size_t b = 0; b < count; ++b) {
+            results.push_back(decode(raw_output + b * proposal_length * num_proposals, num_proposals, transforms[b]));
+        }
+    }
+    return results;
+}
 
+// Точки одного человека на каждом изображении
+std::vector<std::vector<Keypoint>> runPoseModel(
+    SessionPool& pool, int cameraId, int input_size, const std::vector<cv::Mat>& images, int num_keypoints)
+{
+    return runPoseModelWith(pool, cameraId, input_size, images,
+        [num_keypoints](const float* raw_output, int num_proposals, const LetterboxTransform& transform) {
+            return extractKeypointsFromModel(raw_output, num_proposals, num_keypoints, transform);
+        });
+}
+
+GestureRecognizer::GestureRecognizer() {
     m_classMap = {
         GestureType::ARMS_CROSSED,
         GestureType::NONE,
@@ -150,116 +223,164 @@ GestureRecognizer::GestureRecognizer() {
 GestureRecognizer::~GestureRecognizer() = default;
 
 void GestureRecognizer::loadBodyPoseModel(const std::string& path) {
-    std::string device = ConfigManager::getInstance().getDevice();
-    if (device == "cuda") {
-        OrtCUDAProviderOptions cuda_options{};
-        try { m_bodyPoseSessionOptions->AppendExecutionProvider_CUDA(cuda_options); } 
-        catch (const Ort::Exception& e) { spdlog::error("Failed to add CUDA to BodyPoseModel: {}", e.what()); }
-    }
-    m_bodyPoseSession = std::make_unique<Ort::Session>(*m_bodyPoseEnv, path.c_str(), *m_bodyPoseSessionOptions);
-    spdlog::info("GestureRecognizer: Body Pose model loaded from {}", path);
+    m_bodyPosePool = std::make_unique<SessionPool>("BodyPoseModel", path, ConfigManager::getInstance().getModelConfig("body_pose"), std::vector<std::string>{"output0"});
+    m_bodyPoseInputSize = m_bodyPosePool->inputSize(DEFAULT_INPUT_SIZE);
+    spdlog::info("GestureRecognizer: Body Pose model loaded from {} (input: {})", path, m_bodyPoseInputSize);
 }
 
 void GestureRecognizer::loadHandPoseModel(const std::string& path) {
-    std::string device = ConfigManager::getInstance().getDevice();
-    if (device == "cuda") {
-        OrtCUDAProviderOptions cuda_options{};
-        try { m_handPoseSessionOptions->AppendExecutionProvider_CUDA(cuda_options); } 
-        catch (const Ort::Exception& e) { spdlog::error("Failed to add CUDA to HandPoseModel: {}", e.what()); }
-    }
-    m_handPoseSession = std::make_unique<Ort::Session>(*m_handPoseEnv, path.c_str(), *m_handPoseSessionOptions);
-    spdlog::info("GestureRecognizer: Hand Pose model loaded from {}", path);
+    m_handPosePool = std::make_unique<SessionPool>("HandPoseModel", path, ConfigManager::getInstance().getModelConfig("hand_pose"), std::vector<std::string>{"output0"});
+    m_handPoseInputSize = m_handPosePool->inputSize(DEFAULT_INPUT_SIZE);
+    spdlog::info("GestureRecognizer: Hand Pose model loaded from {} (input: {})", path, m_handPoseInputSize);
 }
 
 void GestureRecognizer::loadClassifierModel(const std::string& path) {
-    m_classifierSession = std::make_unique<Ort::Session>(*m_classifierEnv, path.c_str(), *m_classifierSessionOptions);
+    // Классификатор маленький, он всегда работает на CPU
+    m_classifierPool = std::make_unique<SessionPool>("ClassifierModel", path, ConfigManager::getInstance().getModelConfig("classifier"), std::vector<std::string>{"label", "probabilities"}, false);
     spdlog::info("GestureRecognizer: Classifier model loaded from {}", path);
 }
 
-RecognitionResult GestureRecognizer::recognize(const cv::Mat& personFrame) {
-    RecognitionResult result;
-    if (!m_bodyPoseSession || !m_handPoseSession || !m_classifierSession) {
+std::vector<std::vector<PoseInstance>> GestureRecognizer::detectPoses(const std::vector<cv::Mat>& frames, int cameraId) {
+    if (!m_bodyPosePool) {
+        throw std::runtime_error("GestureRecognizer body pose model not loaded!");
+    }
+    if (frames.empty()) return {};
+
+    return runPoseModelWith(*m_bodyPosePool, cameraId, m_bodyPoseInputSize, frames,
+        [](const float* raw_output, int num_proposals, const LetterboxTransform& transform) {
+            return extractPoseInstancesFromModel(raw_output, num_proposals, 17, transform, MAX_POSE_INSTANCES);
+        });
+}
+
+bool GestureRecognizer::isPinned(int cameraId) const {
+    return (m_bodyPosePool && m_bodyPosePool->isPinned(cameraId))
+        || (m_handPosePool && m_handPosePool->isPinned(cameraId))
+        || (m_classifierPool && m_classifierPool->isPinned(cameraId));
+}
+
+RecognitionResult GestureRecognizer::recognize(const cv::Mat& personFrame, int cameraId) {
+    return recognizeBatch({personFrame}, cameraId).front();
+}
+
+std::vector<RecognitionResult> GestureRecognizer::recognizeBatch(const std::vector<cv::Mat>& personFrames, int cameraId) {
+    if (!m_bodyPosePool || !m_handPosePool || !m_classifierPool) {
         throw std::runtime_error("GestureRecognizer models not loaded!");
     }
-    
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    std::vector<int64_t> input_shape{1, 3, INPUT_HEIGHT, INPUT_WIDTH};
-
-    // Анализ позы (17 точек)
-    cv::Mat body_blob;
-    cv::dnn::blobFromImage(personFrame, body_blob, 1./255., cv::Size(INPUT_WIDTH, INPUT_HEIGHT), cv::Scalar(), true, false);
-    Ort::Value body_input_tensor = Ort::Value::CreateTensor<float>(memory_info, (float*)body_blob.data, body_blob.total(), input_shape.data(), input_shape.size());
-    
-    const char* input_names[] = {"images"};
-    const char* output_names[] = {"output0"};
-    auto body_pose_tensors = m_bodyPoseSession->Run(Ort::RunOptions{nullptr}, input_names, &body_input_tensor, 1, output_names, 1);
-    
-    result.poseKeypoints = extractKeypointsFromModel(
-        body_pose_tensors[0], 17, 
-        personFrame.cols / (float)INPUT_WIDTH, 
-        personFrame.rows / (float)INPUT_HEIGHT
-    );
-    
-    std::vector<Keypoint> lh_kps(21, {cv::Point2f(0,0), 0.0f});
-    std::vector<Keypoint> rh_kps(21, {cv::Point2f(0,0), 0.0f});
-
-    // Анализ кисти
-    bool left_up = result.poseKeypoints.size() == 17 && result.poseKeypoints[LEFT_WRIST].point.y < result.poseKeypoints[LEFT_ELBOW].point.y && result.poseKeypoints[LEFT_WRIST].confidence > 0.5;
-    bool right_up = result.poseKeypoints.size() == 17 && result.poseKeypoints[RIGHT_WRIST].point.y < result.poseKeypoints[RIGHT_ELBOW].point.y && result.poseKeypoints[RIGHT_WRIST].confidence > 0.5;
-    
-    if (left_up || right_up) {
-        Keypoint wrist = left_up ? result.poseKeypoints[LEFT_WRIST] : result.poseKeypoints[RIGHT_WRIST];
-        Keypoint elbow = left_up ? result.poseKeypoints[LEFT_ELBOW] : result.poseKeypoints[RIGHT_ELBOW];
-        
-        cv::Point2f forearm_vector = wrist.point - elbow.point;
-        float forearm_length = cv::norm(forearm_vector);
-        
-        if (forearm_length > 30) {
-            cv::Point2f hand_center = wrist.point + (forearm_vector / forearm_length) * forearm_length * 0.6f;
-            int box_size = static_cast<int>(forearm_length * 2.5f);
-            cv::Rect handRoi(hand_center.x - box_size / 2, hand_center.y - box_size / 2, box_size, box_size);
-            handRoi &= cv::Rect(0, 0, personFrame.cols, personFrame.rows);
-
-            if (handRoi.width > 20 && handRoi.height > 20) {
-                cv::Mat handFrame = personFrame(handRoi);
-                cv::Mat hand_blob;
-                cv::dnn::blobFromImage(handFrame, hand_blob, 1./255., cv::Size(INPUT_WIDTH, INPUT_HEIGHT), cv::Scalar(), true, false);
-                Ort::Value hand_input_tensor = Ort::Value::CreateTensor<float>(memory_info, (float*)hand_blob.data, hand_blob.total(), input_shape.data(), input_shape.size());
-                
-                auto hand_pose_tensors = m_handPoseSession->Run(Ort::RunOptions{nullptr}, input_names, &hand_input_tensor, 1, output_names, 1);
-                
-                std::vector<Keypoint> precise_hand_kps = extractKeypointsFromModel(
-                    hand_pose_tensors[0], 21,
-                    handFrame.cols / (float)INPUT_WIDTH,
-                    handFrame.rows / (float)INPUT_HEIGHT,
-                    handRoi.x, handRoi.y
-                );
-                
-                if (left_up) lh_kps = precise_hand_kps;
-                else rh_kps = precise_hand_kps;
+    if (personFrames.empty()) return {};
+
+    // Анализ позы (17 точек) для всех людей одним батчем
+    auto body_keypoints = runPoseModel(*m_bodyPosePool, cameraId, m_bodyPoseInputSize, personFrames, 17);
+    return recognizeFromPoses(personFrames, std::move(body_keypoints), cameraId);
+}
+
+std::vector<RecognitionResult> GestureRecognizer::recognizeFromPoses(
+    const std::vector<cv::Mat>& personFrames, std::vector<std::vector<Keypoint>> body_keypoints, int cameraId) {
+    if (!m_handPosePool || !m_classifierPool) {
+        throw std::runtime_error("GestureRecognizer models not loaded!");
+    }
+    if (personFrames.size() != body_keypoints.size()) {
+        throw std::runtime_error("GestureRecognizer: poses do not match frames");
+    }
+
+    std::vector<RecognitionResult> results(personFrames.size());
+    if (personFrames.empty()) return results;
+
+    // Анализ кисти: собираем кисти всех людей в один батч
+    std::vector<cv::Mat> hand_frames;
+    std::vector<cv::Rect> hand_rois;
+    std::vector<size_t> hand_owners;
+    std::vector<bool> hand_is_left;
+
+    for (size_t p = 0; p < personFrames.size(); ++p) {
+        const cv::Mat& personFrame = personFrames[p];
+        RecognitionResult& result = results[p];
+        result.poseKeypoints = std::move(body_keypoints[p]);
+        result.leftHandKeypoints.assign(21, {cv::Point2f(0,0), 0.0f});
+        result.rightHandKeypoints.assign(21, {cv::Point2f(0,0), 0.0f});
+
+        if (result.poseKeypoints.size() != 17) continue;
+
+        // Обе поднятые руки идут в общий батч кистей
+        const std::pair<BodyParts, BodyParts> arms[] = {{LEFT_WRIST, LEFT_ELBOW}, {RIGHT_WRIST, RIGHT_ELBOW}};
+        for (const auto& [wrist_idx, elbow_idx] : arms) {
+            const Keypoint& wrist = result.poseKeypoints[wrist_idx];
+            const Keypoint& elbow = result.poseKeypoints[elbow_idx];
+            bool arm_up = wrist.point.y < elbow.point.y && wrist.confidence > 0.5;
+            if (!arm_up) continue;
+            
+            cv::Point2f forearm_vector = wrist.point - elbow.point;
+            float forearm_length = cv::norm(forearm_vector);
+            
+            if (forearm_length > 30) {
+                cv::Point2f hand_center = wrist.point + (forearm_vector / forearm_length) * forearm_length * 0.6f;
+                int box_size = static_cast<int>(forearm_length * 2.5f);
+                cv::Rect handRoi(hand_center.x - box_size / 2, hand_center.y - box_size / 2, box_size, box_size);
+                handRoi &= cv::Rect(0, 0, personFrame.cols, personFrame.rows);
+
+                if (handRoi.width > 20 && handRoi.height > 20) {
+                    hand_frames.push_back(personFrame(handRoi));
+                    hand_rois.push_back(handRoi);
+                    hand_owners.push_back(p);
+                    hand_is_left.push_back(wrist_idx == LEFT_WRIST);
+                }
             }
         }
     }
 
-    result.leftHandKeypoints = lh_kps;
-    result.rightHandKeypoints = rh_kps;
-
-    // Классификация
-    std::vector<float> normalized_features = normalizeYoloLandmarks(result.poseKeypoints, result.leftHandKeypoints, result.rightHandKeypoints);
-
-    std::vector<int64_t> classifier_input_shape{1, static_cast<long long>(normalized_features.size())};
-    Ort::Value classifier_input_tensor = Ort::Value::CreateTensor<float>(memory_info, normalized_features.data(), normalized_features.size(), classifier_input_shape.data(), classifier_input_shape.size());
-    
-    const char* classifier_input_names[] = {"float_input"};
-    const char* classifier_output_names[] = {"label"};
-    auto classifier_output = m_classifierSession->Run(Ort::RunOptions{nullptr}, classifier_input_names, &classifier_input_tensor, 1, classifier_output_names, 1);
-    
-    const int64_t* label_tensor = classifier_output[0].GetTensorData<int64_t>();
-    int64_t predicted_index = label_tensor[0];
-    
-    if (predicted_index >= 0 && predicted_index < m_classMap.size()) {
-        result.finalGesture = m_classMap[predicted_index];
+    if (!hand_frames.empty()) {
+        auto hand_keypoints = runPoseModel(*m_handPosePool, cameraId, m_handPoseInputSize, hand_frames, 21);
+        for (size_t h = 0; h < hand_frames.size(); ++h) {
+            std::vector<Keypoint>& precise_hand_kps = hand_keypoints[h];
+            // Перевод точек из координат кисти в координаты человека
+            for (auto& kp : precise_hand_kps) {
+                if (kp.confidence > 0.0f) {
+                    kp.point += cv::Point2f(hand_rois[h].x, hand_rois[h].y);
+                }
+            }
+            RecognitionResult& result = results[hand_owners[h]];
+            if (hand_is_left[h]) result.leftHandKeypoints = std::move(precise_hand_kps);
+            else result.rightHandKeypoints = std::move(precise_hand_kps);
+        }
     }
 
-    return result;
-} 
\ No newline at end of file
+    // Классификация: признаки всех людей одной матрицей [N, 118]
+    std::vector<float> features;
+    int64_t feature_length = 0;
+    for (auto& result : results) {
+        std::vector<float> normalized_features = normalizeYoloLandmarks(result.poseKeypoints, result.leftHandKeypoints, result.rightHandKeypoints);
+        feature_length = static_cast<int64_t>(normalized_features.size());
+        features.insert(features.end(), normalized_features.begin(), normalized_features.end());
+    }
+
+    auto classifier = m_classifierPool->checkout(cameraId);
+    size_t chunk_size = m_classifierPool->batchSize() > 0 ? static_cast<size_t>(m_classifierPool->batchSize()) : results.size();
+    for (size_t offset = 0; offset < results.size(); offset += chunk_size) {
+        size_t count = std::min(chunk_size, results.size() - offset);
+        // Классификатор с фиксированным батчем получает полный батч, лишние строки нулевые и не читаются
+        int64_t rows = std::max(static_cast<int64_t>(count), classifier->batchSize());
+        std::vector<int64_t> classifier_input_shape{rows, feature_length};
+        float* classifier_input = classifier->prepareInput<float>(classifier_input_shape);
+        std::copy_n(features.data() + offset * feature_length, count * feature_length, classifier_input);
+        std::fill(classifier_input + count * feature_length, classifier_input + rows * feature_length, 0.0f);
+
+        classifier->run();
+        const int64_t* label_tensor = classifier->outputData<int64_t>(0);
+        const float* probability_tensor = classifier->outputData<float>(1);
+        size_t probability_stride = static_cast<size_t>(classifier->outputShape(1).back());
+        size_t num_classes = std::min(probability_stride, m_classMap.size());
+
+        for (size_t i = 0; i < count; ++i) {
+            RecognitionResult& result = results[offset + i];
+            int64_t predicted_index = label_tensor[i];
+            if (predicted_index >= 0 && predicted_index < static_cast<int64_t>(m_classMap.size())) {
+                result.finalGesture = m_classMap[predicted_index];
+            }
+            result.gestureProbabilities.assign(GESTURE_TYPE_COUNT, 0.0f);
+            for (size_t c = 0; c < num_classes; ++c) {
+                result.gestureProbabilities[static_cast<size_t>(m_classMap[c])] = probability_tensor[i * probability_stride + c];
+            }
+        }
+    }
+
+    return results;
+}
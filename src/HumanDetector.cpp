@@ -2,116 +2,257 @@
 
 #include "HumanDetector.h"
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <cmath>
 #include <onnxruntime_cxx_api.h>
-#include <opencv2/dnn.hpp>
 #include "spdlog/spdlog.h"
 #include "ConfigManager.h"
+#include "Preprocessing.h"
+#include "YoloDecoder.h"
+#include "Nms.h"
 
 // --- Параметры модели ---
-const int INPUT_WIDTH = 640;
-const int INPUT_HEIGHT = 640;
+// Размер входа по умолчанию для модели с динамическим входом
+const int DEFAULT_INPUT_SIZE = 640;
 const float SCORE_THRESHOLD = 0.5f;
 const float NMS_THRESHOLD = 0.45f;
-const float CONFIDENCE_THRESHOLD = 0.45f;
+const int PERSON_CLASS_ID = 0;
+// Шаг сетки YOLO: стороны динамического входа кратны ему
+const int MODEL_STRIDE = 32;
+// Больше людей в одной зоне не бывает, после этого NMS прекращается
+const size_t MAX_DETECTIONS = 100;
 
 
-HumanDetector::HumanDetector() {
-    m_env = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "human-detector");
-    m_sessionOptions = std::make_unique<Ort::SessionOptions>();
+// Разбор выхода YOLO [4 + num_classes, N] для одного кадра, transform переводит рамки обратно в координаты кадра
+static std::vector<cv::Rect> decodeDetections(const float* raw_output, int num_proposals, int num_classes, const LetterboxTransform& transform) {
+    thread_local std::vector<float> confidences;
+    thread_local std::vector<cv::Rect> boxes;
+    thread_local std::vector<int> nms_result;
+    confidences.clear();
+    boxes.clear();
+
+    for (const auto& detection : decodeYoloClass(raw_output, num_proposals, num_classes, PERSON_CLASS_ID, SCORE_THRESHOLD)) {
+        confidences.push_back(detection.score);
+        boxes.push_back(cv::Rect(transform.toSource(detection.box)));
+    }
+
+    nmsBoxes(boxes, confidences, SCORE_THRESHOLD, NMS_THRESHOLD, nms_result, MAX_DETECTIONS);
+
+    std::vector<cv::Rect> final_boxes;
+    final_boxes.reserve(nms_result.size());
+    for (int idx : nms_result) {
+        final_boxes.push_back(boxes[idx]);
+    }
+
+    return final_boxes;
+}
+
+// Выход модели со встроенными разбором и NMS (в координатах входа модели):
+// [K, 6] - строки (номер кадра в батче, x1, y1, x2, y2, score), только люди;
+// [B, K, 6] - для каждого кадра строки (x1, y1, x2, y2, score, class), хвост дополнен нулевыми оценками
+static bool isEndToEndOutput(const std::vector<int64_t>& shape) {
+    return (shape.size() == 2 || shape.size() == 3) && shape.back() == 6;
 }
 
+static void decodeEndToEnd(const float* raw_output, const std::vector<int64_t>& shape, const std::vector<LetterboxTransform>& transforms, std::vector<std::vector<cv::Rect>>& results) {
+    auto toSource = [](const LetterboxTransform& transform, const float* xyxy) {
+        return cv::Rect(transform.toSource(cv::Rect2f(xyxy[0], xyxy[1], xyxy[2] - xyxy[0], xyxy[3] - xyxy[1])));
+    };
+
+    if (shape.size() == 2) {
+        for (int64_t k = 0; k < shape[0]; ++k) {
+            const float* row = raw_output + k * 6;
+            size_t b = static_cast<size_t>(row[0]);
+            if (b >= transforms.size() || row[5] <= SCORE_THRESHOLD) continue;
+            results[b].push_back(toSource(transforms[b], row + 1));
+        }
+        return;
+    }
+
+    for (size_t b = 0; b < transforms.size() && static_cast<int64_t>(b) < shape[0]; ++b) {
+        for (int64_t k = 0; k < shape[1]; ++k) {
+            const float* row = raw_output + (b * shape[1] + k) * 6;
+            if (row[4] <= SCORE_THRESHOLD || static_cast<int>(row[5]) != PERSON_CLASS_ID) continue;
+            results[b].push_back(toSource(transforms[b], row));
+        }
+    }
+}
+
+HumanDetector::HumanDetector() = default;
+
 HumanDetector::~HumanDetector() = default;
 
 void HumanDetector::loadModel(const std::string& path) {
-    std::string device = ConfigManager::getInstance().getDevice();
-    m_sessionOptions->SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-    
-    if (device == "cuda"){
-        OrtCUDAProviderOptions cuda_options{};
-        try{
-            m_sessionOptions->AppendExecutionProvider_CUDA(cuda_options);
-            spdlog::info("Attempting to use CUDA execution provider.");
-        }
-        catch (const Ort::Exception& e) {
-            spdlog::error("Failed to append CUDA  provider. Error {}", e.what());
+    m_pool = std::make_unique<SessionPool>("HumanDetector", path, ConfigManager::getInstance().getModelConfig("detector"), std::vector<std::string>{"output0"});
+
+    m_inputSize = m_pool->inputSize(DEFAULT_INPUT_SIZE);
+    m_dynamicShape = m_pool->dynamicSpatialShape();
+    auto output_shape = m_pool->model().modelOutputShape(0);
+    m_endToEnd = isEndToEndOutput(output_shape);
+
+    // Число классов берётся из выхода [1, 4 + nc, N]: урезанная до людей голова даёт [1, 5, N]
+    std::string output = "final boxes";
+    if (!m_endToEnd) {
+        int64_t channels = output_shape.size() == 3 ? output_shape[1] : -1;
+        if (channels > 0 && channels <= 4 + PERSON_CLASS_ID) {
+            throw std::runtime_error("HumanDetector: output0 has no person class scores in " + path);
         }
+        output = channels > 0 ? std::to_string(channels - 4) + " classes" : "dynamic classes";
     }
-    else {
-        spdlog::info("Using CPU execution provider");
+
+    int64_t batch_size = m_pool->batchSize();
+    spdlog::info("HumanDetector: loaded model from {} (input: {}{}, batch: {}, output: {})", path, m_inputSize,
+        m_dynamicShape ? " long side, fitted to frame aspect" : "", batch_size > 0 ? std::to_string(batch_size) : "dynamic", output);
+}
+
+cv::Size HumanDetector::inputSizeFor(const cv::Size& frameSize) const {
+    if (!m_dynamicShape || frameSize.area() <= 0) {
+        return cv::Size(m_inputSize, m_inputSize);
     }
-    
-    m_session = std::make_unique<Ort::Session>(*m_env, path.c_str(), *m_sessionOptions);
+    // Длинная сторона - m_inputSize, короткая - ближайшее кратное шагу сетки при пропорциях кадра
+    int long_side = std::max(frameSize.width, frameSize.height);
+    int short_side = std::min(frameSize.width, frameSize.height);
+    int fitted = static_cast<int>(std::lround(static_cast<double>(m_inputSize) * short_side / long_side / MODEL_STRIDE)) * MODEL_STRIDE;
+    fitted = std::clamp(fitted, MODEL_STRIDE, m_inputSize);
+    return frameSize.width >= frameSize.height ? cv::Size(m_inputSize, fitted) : cv::Size(fitted, m_inputSize);
+}
 
-    spdlog::info("HumanDetector: loaded model from {}", path);
+void HumanDetector::warmup(const std::vector<cv::Size>& frameSizes, int maxBatchSize) {
+    if (!m_pool) {
+        throw std::runtime_error("HumanDetector model not loaded!");
+    }
+    std::vector<cv::Size> input_sizes;
+    for (const auto& frame_size : frameSizes) {
+        cv::Size input_size = inputSizeFor(frame_size);
+        if (std::find(input_sizes.begin(), input_sizes.end(), input_size) == input_sizes.end()) {
+            input_sizes.push_back(input_size);
+            spdlog::info("HumanDetector: input {}x{} for frames {}x{}", input_size.width, input_size.height, frame_size.width, frame_size.height);
+        }
+    }
+    m_pool->warmup(input_sizes, maxBatchSize);
+}
+
+bool HumanDetector::isPinned(int cameraId) const {
+    return m_pool && m_pool->isPinned(cameraId);
+}
+
+std::vector<cv::Rect> HumanDetector::detect(const cv::Mat& frame, int cameraId) {
+    return detectBatch({frame}, cameraId).front();
 }
 
-std::vector<cv::Rect> HumanDetector::detect(const cv::Mat& frame) {
-    if (!m_session) {
+std::vector<std::vector<cv::Rect>> HumanDetector::detectBatch(const std::vector<cv::Mat>& frames, int cameraId) {
+    return detectBatchAsync(frames, cameraId).get();
+}
+
+std::future<std::vector<std::vector<cv::Rect>>> HumanDetector::detectBatchAsync(const std::vector<cv::Mat>& frames, int cameraId) {
+    auto promise = std::make_shared<std::promise<std::vector<std::vector<cv::Rect>>>>();
+    auto future = promise->get_future();
+    detectBatchAsync(frames, cameraId, [promise](std::vector<std::vector<cv::Rect>> detections, std::exception_ptr error) {
+        if (error) promise->set_exception(error);
+        else promise->set_value(std::move(detections));
+    });
+    return future;
+}
+
+void HumanDetector::detectBatchAsync(const std::vector<cv::Mat>& frames, int cameraId, DetectCallback callback) {
+    if (!m_pool) {
         throw std::runtime_error("HumanDetector model not loaded!");
     }
 
-    cv::Mat blob;
-    cv::dnn::blobFromImage(frame, blob, 1./255., cv::Size(INPUT_WIDTH, INPUT_HEIGHT), cv::Scalar(), true, false);
-
-    size_t input_tensor_size = INPUT_WIDTH * INPUT_HEIGHT * 3;
-    std::vector<int64_t> input_shape{1, 3, INPUT_HEIGHT, INPUT_WIDTH};
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, (float*)blob.data, input_tensor_size, input_shape.data(), input_shape.size());
-
-    const char* input_names[] = {"images"};
-    const char* output_names[] = {"output0"};
-    auto output_tensors = m_session->Run(Ort::RunOptions{nullptr}, input_names, &input_tensor, 1, output_names, 1);
-
-    const float* raw_output = output_tensors[0].GetTensorData<float>();
-    
-    auto shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
-    int num_proposals = shape[2]; 
-    int proposal_length = shape[1];
-
-    std::vector<int> class_ids;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
-
-    float x_factor = frame.cols / (float)INPUT_WIDTH;
-    float y_factor = frame.rows / (float)INPUT_HEIGHT;
-
-    for (int i = 0; i < num_proposals; ++i) {
-        const float* proposal_data = raw_output + i;
-        
-        const float* class_scores = proposal_data + 4 * num_proposals;
-
-        cv::Mat scores(80, 1, CV_32F, (void*)class_scores, num_proposals * sizeof(float));
-        cv::Point class_id_point;
-        double max_score;
-        cv::minMaxLoc(scores, 0, &max_score, 0, &class_id_point);
-
-        if (max_score > SCORE_THRESHOLD) {
-            if (class_id_point.y == 0) { 
-                confidences.push_back(max_score);
-                class_ids.push_back(class_id_point.y);
-
-                float cx = proposal_data[0 * num_proposals];
-                float cy = proposal_data[1 * num_proposals];
-                float w = proposal_data[2 * num_proposals];
-                float h = proposal_data[3 * num_proposals];
-
-                int left = static_cast<int>((cx - 0.5 * w) * x_factor);
-                int top = static_cast<int>((cy - 0.5 * h) * y_factor);
-                int width = static_cast<int>(w * x_factor);
-                int height = static_cast<int>(h * y_factor);
-
-                boxes.push_back(cv::Rect(left, top, width, height));
-            }
+    // Общее состояние частей батча, callback вызывается после завершения последней
+    struct BatchState {
+        std::mutex mutex;
+        std::vector<std::vector<cv::Rect>> results;
+        std::exception_ptr error;
+        size_t remaining = 0;
+        DetectCallback callback;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->results.resize(frames.size());
+    state->callback = std::move(callback);
+
+    auto finishChunk = [state](std::exception_ptr error) {
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) state->error = error;
+            done = --state->remaining == 0;
+        }
+        if (done) {
+            state->callback(std::move(state->results), state->error);
         }
+    };
+
+    // Кадры с разной формой входа не смешиваются в одном прогоне
+    std::map<std::pair<int, int>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::Size input_size = inputSizeFor(frames[i].size());
+        groups[{input_size.width, input_size.height}].push_back(i);
     }
 
-    std::vector<int> nms_result;
-    cv::dnn::NMSBoxes(boxes, confidences, SCORE_THRESHOLD, NMS_THRESHOLD, nms_result);
-    
-    std::vector<cv::Rect> final_boxes;
-    for (int idx : nms_result) {
-        final_boxes.push_back(boxes[idx]);
+    // Модель с фиксированным батчем прогоняем частями, каждая часть на своей аренде реплики.
+    // Неполную последнюю часть prepareImages дополняет до батча модели
+    int64_t batch_size = m_pool->batchSize();
+    std::vector<std::vector<size_t>> chunks;
+    for (const auto& [input_size, indices] : groups) {
+        size_t chunk_size = batch_size > 0 ? static_cast<size_t>(batch_size) : indices.size();
+        for (size_t offset = 0; offset < indices.size(); offset += chunk_size) {
+            size_t count = std::min(chunk_size, indices.size() - offset);
+            chunks.emplace_back(indices.begin() + offset, indices.begin() + offset + count);
+        }
+    }
+    state->remaining = chunks.size();
+    if (state->remaining == 0) {
+        state->callback({}, nullptr);
+        return;
     }
 
-    return final_boxes;
-}
\ No newline at end of file
+    for (auto& indices : chunks) {
+        try {
+            auto model = std::make_shared<SessionPool::Lease>(m_pool->checkout(cameraId));
+            std::vector<cv::Mat> chunk;
+            chunk.reserve(indices.size());
+            for (size_t index : indices) {
+                chunk.push_back(frames[index]);
+            }
+
+            // Подготовка пишет прямо в привязанный входной тензор, кадр вписывается без искажения
+            auto transforms = m_pool->prepareImages(**model, chunk, inputSizeFor(chunk.front().size()));
+
+            bool end_to_end = m_endToEnd;
+            (*model)->runAsync([state, model, indices = std::move(indices), transforms, end_to_end, finishChunk](std::exception_ptr error) mutable {
+                if (!error) {
+                    try {
+                        const float* raw_output = (*model)->outputData<float>(0);
+                        auto shape = (*model)->outputShape(0);
+                        std::vector<std::vector<cv::Rect>> results(transforms.size());
+                        if (end_to_end) {
+                            decodeEndToEnd(raw_output, shape, transforms, results);
+                        }
+                        else {
+                            int proposal_length = shape[1];
+                            int num_proposals = shape[2];
+                            for (size_t b = 0; b < transforms.size(); ++b) {
+                                results[b] = decodeDetections(raw_output + b * proposal_length * num_proposals, num_proposals, proposal_length - 4, transforms[b]);
+                            }
+                        }
+                        // Части пишут в разные кадры, блокировка не нужна
+                        for (size_t b = 0; b < indices.size(); ++b) {
+                            state->results[indices[b]] = std::move(results[b]);
+                        }
+                    }
+                    catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+                // Реплика возвращается в пул сразу после чтения выхода
+                model.reset();
+                finishChunk(error);
+            });
+        }
+        catch (...) {
+            finishChunk(std::current_exception());
+        }
+    }
+}
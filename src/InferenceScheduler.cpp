@@ -0,0 +1,330 @@
+// InferenceScheduler.cpp
+
+#include "InferenceScheduler.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Квант DRR на единицу веса камеры, в единицах инференса
+const int DRR_QUANTUM = 4;
+// Сглаживание среднего времени ожидания
+const double WAIT_EMA_ALPHA = 0.1;
+
+InferenceScheduler::InferenceScheduler(
+    std::unique_ptr<HumanDetector> humanDetector,
+    std::unique_ptr<GestureRecognizer> gestureRecognizer,
+    const std::vector<CameraConfig>& cameraConfigs,
+    int maxBatchSize,
+    std::chrono::milliseconds maxBatchDelay,
+    int workers)
+    : m_humanDetector(std::move(humanDetector)),
+        m_gestureRecognizer(std::move(gestureRecognizer)),
+        m_maxBatchSize(static_cast<size_t>(std::max(1, maxBatchSize))),
+        m_maxBatchDelay(maxBatchDelay),
+        m_isRunning(true) {
+
+    for (const auto& camConfig : cameraConfigs) {
+        m_queues[camConfig.id].weight = std::max(1, camConfig.weight);
+        m_cameraOrder.push_back(camConfig.id);
+        spdlog::info("InferenceScheduler: camera ID {} weight {}", camConfig.id, m_queues[camConfig.id].weight);
+    }
+
+    for (int i = 0; i < std::max(1, workers); ++i) {
+        m_workers.emplace_back(&InferenceScheduler::workerLoop, this);
+    }
+    spdlog::info("InferenceScheduler: {} workers", m_workers.size());
+}
+
+InferenceScheduler::~InferenceScheduler() {
+    stop();
+}
+
+void InferenceScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isRunning.store(false);
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+std::future<std::vector<cv::Rect>> InferenceScheduler::submitDetect(int cameraId, const cv::Mat& frame) {
+    Job job;
+    job.type = JobType::DETECT;
+    job.cameraId = cameraId;
+    job.cost = 1;
+    job.frame = frame;
+    auto result = job.detectPromise.get_future();
+    enqueue(std::move(job));
+    return result;
+}
+
+std::future<std::vector<RecognitionResult>> InferenceScheduler::submitRecognize(int cameraId, std::vector<cv::Mat> personFrames) {
+    Job job;
+    job.type = JobType::RECOGNIZE;
+    job.cameraId = cameraId;
+    job.cost = std::max<int>(1, static_cast<int>(personFrames.size()));
+    job.personFrames = std::move(personFrames);
+    auto result = job.recognizePromise.get_future();
+    enqueue(std::move(job));
+    return result;
+}
+
+std::future<std::vector<PoseInstance>> InferenceScheduler::submitPoses(int cameraId, const cv::Mat& frame) {
+    Job job;
+    job.type = JobType::POSE;
+    job.cameraId = cameraId;
+    job.cost = 1;
+    job.frame = frame;
+    auto result = job.posePromise.get_future();
+    enqueue(std::move(job));
+    return result;
+}
+
+std::future<std::vector<RecognitionResult>> InferenceScheduler::submitRecognize(int cameraId, const cv::Mat& frame, std::vector<std::vector<Keypoint>> poses) {
+    std::vector<cv::Mat> personFrames(poses.size(), frame);
+    return submitRecognize(cameraId, std::move(personFrames), std::move(poses));
+}
+
+std::future<std::vector<RecognitionResult>> InferenceScheduler::submitRecognize(int cameraId, std::vector<cv::Mat> personFrames, std::vector<std::vector<Keypoint>> poses) {
+    Job job;
+    job.type = JobType::RECOGNIZE;
+    job.cameraId = cameraId;
+    job.cost = std::max<int>(1, static_cast<int>(poses.size()));
+    job.personFrames = std::move(personFrames);
+    job.poses = std::move(poses);
+    auto result = job.recognizePromise.get_future();
+    enqueue(std::move(job));
+    return result;
+}
+
+void InferenceScheduler::enqueue(Job&& job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isRunning.load()) {
+            throw std::runtime_error("InferenceScheduler is stopped");
+        }
+        // Камера не из конфигурации получает вес по умолчанию
+        if (m_queues.find(job.cameraId) == m_queues.end()) {
+            m_cameraOrder.push_back(job.cameraId);
+        }
+        job.enqueuedAt = std::chrono::steady_clock::now();
+        CameraQueue& queue = m_queues[job.cameraId];
+        queue.jobs.push_back(std::move(job));
+        queue.stats.queueDepth = queue.jobs.size();
+        ++m_pendingJobs;
+        if (queue.jobs.back().type == JobType::DETECT) ++m_pendingDetectJobs;
+    }
+    m_cv.notify_all();
+}
+
+CameraQueueStats InferenceScheduler::getStats(int cameraId) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_queues.find(cameraId);
+    return it != m_queues.end() ? it->second.stats : CameraQueueStats{};
+}
+
+std::map<int, CameraQueueStats> InferenceScheduler::getAllStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<int, CameraQueueStats> stats;
+    for (const auto& [cameraId, queue] : m_queues) {
+        stats[cameraId] = queue.stats;
+    }
+    return stats;
+}
+
+std::vector<InferenceScheduler::Job> InferenceScheduler::selectJobsLocked() {
+    std::vector<Job> selected;
+    auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < m_cameraOrder.size(); ++i) {
+        CameraQueue& queue = m_queues[m_cameraOrder[(m_roundStart + i) % m_cameraOrder.size()]];
+        if (queue.jobs.empty()) continue;
+
+        queue.deficit += DRR_QUANTUM * queue.weight;
+        while (!queue.jobs.empty() && queue.jobs.front().cost <= queue.deficit) {
+            Job& job = queue.jobs.front();
+            queue.deficit -= job.cost;
+
+            double waitMs = std::chrono::duration<double, std::milli>(now - job.enqueuedAt).count();
+            queue.stats.lastWaitMs = waitMs;
+            queue.stats.avgWaitMs = queue.stats.servedJobs == 0
+                ? waitMs
+                : queue.stats.avgWaitMs + WAIT_EMA_ALPHA * (waitMs - queue.stats.avgWaitMs);
+            ++queue.stats.servedJobs;
+
+            if (job.type == JobType::DETECT) --m_pendingDetectJobs;
+            selected.push_back(std::move(job));
+            queue.jobs.pop_front();
+            --m_pendingJobs;
+        }
+        // Пустая очередь не копит дефицит
+        if (queue.jobs.empty()) {
+            queue.deficit = 0;
+        }
+        queue.stats.queueDepth = queue.jobs.size();
+    }
+
+    if (!m_cameraOrder.empty()) {
+        m_roundStart = (m_roundStart + 1) % m_cameraOrder.size();
+    }
+    return selected;
+}
+
+void InferenceScheduler::workerLoop() {
+    while (true) {
+        std::vector<Job> selected;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_isRunning.load() || m_pendingJobs > 0; });
+            if (m_pendingJobs == 0) {
+                break;
+            }
+
+            // Батч набирается только для детектора: если самая старая задача - детекция,
+            // ждём детекции других камер, но не дольше m_maxBatchDelay от неё
+            auto oldest = std::chrono::steady_clock::time_point::max();
+            bool oldestIsDetect = false;
+            for (const auto& [cameraId, queue] : m_queues) {
+                if (!queue.jobs.empty() && queue.jobs.front().enqueuedAt < oldest) {
+                    oldest = queue.jobs.front().enqueuedAt;
+                    oldestIsDetect = queue.jobs.front().type == JobType::DETECT;
+                }
+            }
+            if (oldestIsDetect) {
+                m_cv.wait_until(lock, oldest + m_maxBatchDelay, [this] {
+                    return !m_isRunning.load() || m_pendingDetectJobs >= m_maxBatchSize;
+                });
+            }
+
+            selected = selectJobsLocked();
+        }
+
+        // Камеры с закреплёнными репликами получают отдельные группы, остальные идут в общую (-1)
+        std::map<int, std::vector<Job>> detectGroups;
+        std::map<int, std::vector<Job>> poseGroups;
+        std::map<int, std::vector<Job>> recognizeGroups;
+        for (auto& job : selected) {
+            if (job.type == JobType::DETECT) {
+                int key = m_humanDetector->isPinned(job.cameraId) ? job.cameraId : -1;
+                detectGroups[key].push_back(std::move(job));
+            }
+            else {
+                int key = m_gestureRecognizer->isPinned(job.cameraId) ? job.cameraId : -1;
+                auto& groups = job.type == JobType::POSE ? poseGroups : recognizeGroups;
+                groups[key].push_back(std::move(job));
+            }
+        }
+        for (auto& [cameraId, jobs] : detectGroups) {
+            runDetectJobs(jobs, cameraId);
+        }
+        for (auto& [cameraId, jobs] : poseGroups) {
+            runPoseJobs(jobs, cameraId);
+        }
+        for (auto& [cameraId, jobs] : recognizeGroups) {
+            runRecognizeJobs(jobs, cameraId);
+        }
+    }
+}
+
+void InferenceScheduler::runDetectJobs(std::vector<Job>& jobs, int cameraId) {
+    for (size_t offset = 0; offset < jobs.size(); offset += m_maxBatchSize) {
+        size_t count = std::min(m_maxBatchSize, jobs.size() - offset);
+        auto batch = std::make_shared<std::vector<Job>>(
+            std::make_move_iterator(jobs.begin() + offset),
+            std::make_move_iterator(jobs.begin() + offset + count));
+        std::vector<cv::Mat> frames;
+        frames.reserve(count);
+        for (const auto& job : *batch) {
+            frames.push_back(job.frame);
+        }
+
+        // Рабочий поток не ждёт завершения батча и сразу берёт следующие задачи
+        try {
+            m_humanDetector->detectBatchAsync(frames, cameraId,
+                [batch](std::vector<std::vector<cv::Rect>> detections, std::exception_ptr error) {
+                    for (size_t i = 0; i < batch->size(); ++i) {
+                        if (error) (*batch)[i].detectPromise.set_exception(error);
+                        else (*batch)[i].detectPromise.set_value(std::move(detections[i]));
+                    }
+                });
+        }
+        catch (...) {
+            for (auto& job : *batch) {
+                job.detectPromise.set_exception(std::current_exception());
+            }
+        }
+    }
+}
+
+void InferenceScheduler::runPoseJobs(std::vector<Job>& jobs, int cameraId) {
+    if (jobs.empty()) return;
+
+    // Кадры всех камер однопроходного режима - один прогон модели позы
+    std::vector<cv::Mat> frames;
+    frames.reserve(jobs.size());
+    for (const auto& job : jobs) {
+        frames.push_back(job.frame);
+    }
+
+    try {
+        auto instances = m_gestureRecognizer->detectPoses(frames, cameraId);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            jobs[i].posePromise.set_value(std::move(instances[i]));
+        }
+    }
+    catch (...) {
+        for (auto& job : jobs) {
+            job.posePromise.set_exception(std::current_exception());
+        }
+    }
+}
+
+void InferenceScheduler::runRecognizeJobs(std::vector<Job>& jobs, int cameraId) {
+    if (jobs.empty()) return;
+
+    // Люди со всех выбранных камер распознаются одним батчем, люди с готовыми позами - отдельным
+    std::vector<Job*> cropJobs;
+    std::vector<Job*> poseJobs;
+    for (auto& job : jobs) {
+        (job.poses.empty() ? cropJobs : poseJobs).push_back(&job);
+    }
+
+    auto runGroup = [](const std::vector<Job*>& group, auto&& recognize) {
+        if (group.empty()) return;
+        std::vector<cv::Mat> personFrames;
+        std::vector<std::vector<Keypoint>> poses;
+        for (const Job* job : group) {
+            personFrames.insert(personFrames.end(), job->personFrames.begin(), job->personFrames.end());
+            poses.insert(poses.end(), job->poses.begin(), job->poses.end());
+        }
+
+        try {
+            auto results = recognize(personFrames, std::move(poses));
+            size_t offset = 0;
+            for (Job* job : group) {
+                size_t count = job->personFrames.size();
+                job->recognizePromise.set_value(std::vector<RecognitionResult>(
+                    std::make_move_iterator(results.begin() + offset),
+                    std::make_move_iterator(results.begin() + offset + count)));
+                offset += count;
+            }
+        }
+        catch (...) {
+            for (Job* job : group) {
+                job->recognizePromise.set_exception(std::current_exception());
+            }
+        }
+    };
+
+    runGroup(cropJobs, [&](const std::vector<cv::Mat>& personFrames, std::vector<std::vector<Keypoint>>) {
+        return m_gestureRecognizer->recognizeBatch(personFrames, cameraId);
+    });
+    runGroup(poseJobs, [&](const std::vector<cv::Mat>& personFrames, std::vector<std::vector<Keypoint>> poses) {
+        return m_gestureRecognizer->recognizeFromPoses(personFrames, std::move(poses), cameraId);
+    });
+}
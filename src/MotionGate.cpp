@@ -0,0 +1,117 @@
+// MotionGate.cpp
+
+#include "MotionGate.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MOTION_GATE_X86_SIMD 1
+#endif
+
+// Ширина уменьшенного кадра: шум сенсора усредняется, проход по кадру занимает микросекунды
+const int GATE_WIDTH = 160;
+// Изменение яркости, которое считается движением
+const uint8_t PIXEL_THRESHOLD = 25;
+// Наибольший сдвиг фона к кадру за один кадр: медленные изменения освещения уходят в фон
+const uint8_t BACKGROUND_STEP = 2;
+
+namespace {
+    // Число пикселей [begin, end), отличающихся от фона больше чем на threshold.
+    // Фон сдвигается к кадру не больше чем на step
+    using MotionKernel = size_t (*)(const uint8_t* frame, uint8_t* background, size_t begin, size_t end, uint8_t threshold, uint8_t step);
+
+    size_t updateMotionScalar(const uint8_t* frame, uint8_t* background, size_t begin, size_t end, uint8_t threshold, uint8_t step) {
+        size_t changed = 0;
+        for (size_t i = begin; i < end; ++i) {
+            int diff = static_cast<int>(frame[i]) - background[i];
+            changed += std::abs(diff) > threshold;
+            background[i] = static_cast<uint8_t>(background[i] + std::clamp<int>(diff, -step, step));
+        }
+        return changed;
+    }
+
+#ifdef MOTION_GATE_X86_SIMD
+    __attribute__((target("avx2,popcnt")))
+    size_t updateMotionAvx2(const uint8_t* frame, uint8_t* background, size_t begin, size_t end, uint8_t threshold, uint8_t step) {
+        // diff > threshold  <=>  max(diff, threshold + 1) == diff
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold + 1));
+        const __m256i max_step = _mm256_set1_epi8(static_cast<char>(step));
+        size_t changed = 0;
+        size_t i = begin;
+        for (; i + 32 <= end; i += 32) {
+            __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(frame + i));
+            __m256i model = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(background + i));
+            // Насыщающие разности: одна из них нулевая
+            __m256i up = _mm256_subs_epu8(current, model);
+            __m256i down = _mm256_subs_epu8(model, current);
+            __m256i diff = _mm256_or_si256(up, down);
+            __m256i moving = _mm256_cmpeq_epi8(_mm256_max_epu8(diff, limit), diff);
+            changed += _mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(moving)));
+
+            model = _mm256_adds_epu8(model, _mm256_min_epu8(up, max_step));
+            model = _mm256_subs_epu8(model, _mm256_min_epu8(down, max_step));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(background + i), model);
+        }
+        return changed + updateMotionScalar(frame, background, i, end, threshold, step);
+    }
+#endif
+
+    MotionKernel selectKernel() {
+#ifdef MOTION_GATE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            return updateMotionAvx2;
+        }
+#endif
+        return updateMotionScalar;
+    }
+}
+
+MotionGate::MotionGate(double threshold, std::chrono::milliseconds keepAlive)
+    : m_threshold(threshold), m_keepAlive(keepAlive) {}
+
+bool MotionGate::shouldRun(const cv::Mat& frame, bool holdOpen) {
+    static const MotionKernel updateMotion = selectKernel();
+    auto now = std::chrono::steady_clock::now();
+
+    double motion = 1.0;
+    if (m_threshold > 0.0 && !frame.empty()) {
+        int width = std::min(frame.cols, GATE_WIDTH);
+        int height = std::max(1, static_cast<int>(std::lround(static_cast<double>(frame.rows) * width / frame.cols)));
+        cv::resize(frame, m_small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+        if (m_small.channels() == 3) cv::cvtColor(m_small, m_gray, cv::COLOR_BGR2GRAY);
+        else m_gray = m_small;
+
+        // Первый кадр или новая геометрия: фона ещё нет, детектор запускается
+        if (m_background.size() != m_gray.size() || !m_gray.isContinuous()) {
+            m_background = m_gray.clone();
+        }
+        else {
+            size_t total = m_gray.total();
+            size_t changed = updateMotion(m_gray.ptr<uint8_t>(), m_background.ptr<uint8_t>(), 0, total, PIXEL_THRESHOLD, BACKGROUND_STEP);
+            motion = static_cast<double>(changed) / total;
+        }
+    }
+
+    bool moving = motion > m_threshold;
+    bool keepAlive = !moving && now - m_lastRun >= m_keepAlive;
+    bool held = !moving && !keepAlive && holdOpen;
+    if (moving || keepAlive || held) {
+        m_lastRun = now;
+    }
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.lastMotion = motion;
+    if (moving) ++m_stats.opened;
+    else if (keepAlive) ++m_stats.keepAlive;
+    else if (held) ++m_stats.held;
+    else ++m_stats.skipped;
+    return moving || keepAlive || held;
+}
+
+MotionGateStats MotionGate::getStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
@@ -0,0 +1,178 @@
+// Nms.cpp
+
+#include "Nms.h"
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define NMS_X86_SIMD 1
+#endif
+
+namespace {
+    // Оставленные рамки в раскладке SoA для векторного IoU
+    struct KeptBoxes {
+        std::vector<float> x1;
+        std::vector<float> y1;
+        std::vector<float> x2;
+        std::vector<float> y2;
+        std::vector<float> area;
+        size_t count = 0;
+
+        void reset(size_t capacity) {
+            for (auto* column : {&x1, &y1, &x2, &y2, &area}) {
+                if (column->size() < capacity) column->resize(capacity);
+            }
+            count = 0;
+        }
+    };
+
+    struct Scratch {
+        std::vector<int> heap;
+        KeptBoxes kept;
+    };
+
+    // Пересекается ли кандидат с какой-либо из оставленных рамок [begin, kept.count) сильнее порога.
+    // Рамки с нулевой суммой площадей считаются совпадающими, как в cv::jaccardDistance
+    using SuppressKernel = bool (*)(const KeptBoxes& kept, size_t begin, const cv::Rect2f& box, float area, float iou_threshold);
+
+    bool suppressedScalar(const KeptBoxes& kept, size_t begin, const cv::Rect2f& box, float area, float iou_threshold) {
+        float bx2 = box.x + box.width;
+        float by2 = box.y + box.height;
+        for (size_t k = begin; k < kept.count; ++k) {
+            float w = std::max(0.0f, std::min(bx2, kept.x2[k]) - std::max(box.x, kept.x1[k]));
+            float h = std::max(0.0f, std::min(by2, kept.y2[k]) - std::max(box.y, kept.y1[k]));
+            float intersection = w * h;
+            float sum = area + kept.area[k];
+            // Произведение float в double точное, поэтому сравнение совпадает с делением в NMSBoxes
+            if (sum <= 0.0f || intersection > static_cast<double>(iou_threshold) * (sum - intersection)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+#ifdef NMS_X86_SIMD
+    __attribute__((target("avx2,fma")))
+    bool suppressedAvx2(const KeptBoxes& kept, size_t begin, const cv::Rect2f& box, float area, float iou_threshold) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 bx1 = _mm256_set1_ps(box.x);
+        const __m256 by1 = _mm256_set1_ps(box.y);
+        const __m256 bx2 = _mm256_set1_ps(box.x + box.width);
+        const __m256 by2 = _mm256_set1_ps(box.y + box.height);
+        const __m256 barea = _mm256_set1_ps(area);
+        const __m256 threshold = _mm256_set1_ps(iou_threshold);
+
+        size_t k = begin;
+        for (; k + 8 <= kept.count; k += 8) {
+            __m256 w = _mm256_max_ps(zero, _mm256_sub_ps(
+                _mm256_min_ps(bx2, _mm256_loadu_ps(kept.x2.data() + k)),
+                _mm256_max_ps(bx1, _mm256_loadu_ps(kept.x1.data() + k))));
+            __m256 h = _mm256_max_ps(zero, _mm256_sub_ps(
+                _mm256_min_ps(by2, _mm256_loadu_ps(kept.y2.data() + k)),
+                _mm256_max_ps(by1, _mm256_loadu_ps(kept.y1.data() + k))));
+            __m256 intersection = _mm256_mul_ps(w, h);
+            __m256 sum = _mm256_add_ps(barea, _mm256_loadu_ps(kept.area.data() + k));
+            // threshold * union - intersection с одним округлением: знак точный
+            __m256 margin = _mm256_fmsub_ps(threshold, _mm256_sub_ps(sum, intersection), intersection);
+            __m256 overlap = _mm256_cmp_ps(margin, zero, _CMP_LT_OQ);
+            __m256 degenerate = _mm256_cmp_ps(sum, zero, _CMP_LE_OQ);
+            if (_mm256_movemask_ps(_mm256_or_ps(overlap, degenerate))) {
+                return true;
+            }
+        }
+        return suppressedScalar(kept, k, box, area, iou_threshold);
+    }
+#endif
+
+    struct KernelInfo {
+        SuppressKernel kernel;
+        const char* name;
+    };
+
+    KernelInfo selectKernel() {
+#ifdef NMS_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return {suppressedAvx2, "avx2"};
+        }
+#endif
+        return {suppressedScalar, "scalar"};
+    }
+
+    const KernelInfo& kernelInfo() {
+        static const KernelInfo info = selectKernel();
+        return info;
+    }
+
+    Scratch& scratch() {
+        thread_local Scratch instance;
+        return instance;
+    }
+}
+
+const char* nmsKernelName() {
+    return kernelInfo().name;
+}
+
+void nmsBoxes(
+    const std::vector<cv::Rect2f>& boxes,
+    const std::vector<float>& scores,
+    float score_threshold,
+    float iou_threshold,
+    std::vector<int>& indices,
+    size_t max_detections) {
+
+    const SuppressKernel suppressed = kernelInfo().kernel;
+    indices.clear();
+
+    Scratch& buffers = scratch();
+    std::vector<int>& heap = buffers.heap;
+    heap.clear();
+    for (size_t i = 0; i < boxes.size() && i < scores.size(); ++i) {
+        if (scores[i] > score_threshold) {
+            heap.push_back(static_cast<int>(i));
+        }
+    }
+
+    // Вершина кучи - наибольшая оценка, при равенстве - меньший индекс (как стабильная сортировка)
+    auto lower_priority = [&scores](int a, int b) {
+        return scores[a] < scores[b] || (scores[a] == scores[b] && a > b);
+    };
+    std::make_heap(heap.begin(), heap.end(), lower_priority);
+
+    size_t limit = max_detections > 0 ? std::min(max_detections, heap.size()) : heap.size();
+    KeptBoxes& kept = buffers.kept;
+    kept.reset(limit);
+
+    while (!heap.empty() && kept.count < limit) {
+        std::pop_heap(heap.begin(), heap.end(), lower_priority);
+        int index = heap.back();
+        heap.pop_back();
+
+        const cv::Rect2f& box = boxes[index];
+        float area = box.width * box.height;
+        if (suppressed(kept, 0, box, area, iou_threshold)) continue;
+
+        kept.x1[kept.count] = box.x;
+        kept.y1[kept.count] = box.y;
+        kept.x2[kept.count] = box.x + box.width;
+        kept.y2[kept.count] = box.y + box.height;
+        kept.area[kept.count] = area;
+        ++kept.count;
+        indices.push_back(index);
+    }
+}
+
+void nmsBoxes(
+    const std::vector<cv::Rect>& boxes,
+    const std::vector<float>& scores,
+    float score_threshold,
+    float iou_threshold,
+    std::vector<int>& indices,
+    size_t max_detections) {
+
+    // Отдельный буфер: основная версия использует свой scratch
+    thread_local std::vector<cv::Rect2f> converted;
+    converted.assign(boxes.begin(), boxes.end());
+    nmsBoxes(converted, scores, score_threshold, iou_threshold, indices, max_detections);
+}
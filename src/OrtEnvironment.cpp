@@ -0,0 +1,74 @@
+// OrtEnvironment.cpp
+
+#include "OrtEnvironment.h"
+#include "ConfigManager.h"
+#include <onnxruntime_cxx_api.h>
+#include "spdlog/spdlog.h"
+
+namespace {
+    GraphOptimizationLevel parseOptimizationLevel(const std::string& level) {
+        if (level == "disable") return GraphOptimizationLevel::ORT_DISABLE_ALL;
+        if (level == "basic") return GraphOptimizationLevel::ORT_ENABLE_BASIC;
+        if (level == "extended") return GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+        if (level != "all") {
+            spdlog::warn("OrtEnvironment: unknown optimization level '{}', using 'all'", level);
+        }
+        return GraphOptimizationLevel::ORT_ENABLE_ALL;
+    }
+}
+
+OrtEnvironment& OrtEnvironment::getInstance() {
+    static OrtEnvironment instance;
+    return instance;
+}
+
+OrtEnvironment::OrtEnvironment() {
+    const OrtThreadingConfig& threading = ConfigManager::getInstance().getThreadingConfig();
+
+    Ort::ThreadingOptions threadingOptions;
+    // 0 - размер пула выбирает ONNX Runtime (по числу физических ядер)
+    threadingOptions.SetGlobalIntraOpNumThreads(threading.intraOpThreads);
+    threadingOptions.SetGlobalInterOpNumThreads(threading.interOpThreads);
+    threadingOptions.SetGlobalSpinControl(threading.allowSpinning ? 1 : 0);
+
+    m_env = std::make_unique<Ort::Env>(threadingOptions, ORT_LOGGING_LEVEL_WARNING, "smart-lightning");
+    spdlog::info("OrtEnvironment: intra-op threads {}, inter-op threads {}, spinning {}",
+        threading.intraOpThreads, threading.interOpThreads, threading.allowSpinning ? "on" : "off");
+}
+
+OrtEnvironment::~OrtEnvironment() = default;
+
+Ort::Env& OrtEnvironment::getEnv() {
+    return *m_env;
+}
+
+Ort::SessionOptions OrtEnvironment::createSessionOptions(
+    const std::string& modelName,
+    const ModelConfig& config,
+    bool allowCuda,
+    int perSessionThreads) const {
+    Ort::SessionOptions sessionOptions;
+    if (perSessionThreads > 0) {
+        sessionOptions.SetIntraOpNumThreads(perSessionThreads);
+    }
+    else {
+        sessionOptions.DisablePerSessionThreads();
+    }
+    sessionOptions.SetGraphOptimizationLevel(parseOptimizationLevel(config.optimizationLevel));
+
+    std::string device = ConfigManager::getInstance().getDevice();
+    if (allowCuda && device == "cuda") {
+        OrtCUDAProviderOptions cuda_options{};
+        try {
+            sessionOptions.AppendExecutionProvider_CUDA(cuda_options);
+            spdlog::info("{}: attempting to use CUDA execution provider.", modelName);
+        }
+        catch (const Ort::Exception& e) {
+            spdlog::error("Failed to add CUDA to {}: {}", modelName, e.what());
+        }
+    }
+    else {
+        spdlog::info("{}: using CPU execution provider", modelName);
+    }
+    return sessionOptions;
+}
@@ -0,0 +1,201 @@
+// OrtModel.cpp
+
+#include "OrtModel.h"
+#include <onnxruntime_cxx_api.h>
+#include <stdexcept>
+#include "spdlog/spdlog.h"
+
+struct OrtModel::Binding {
+    explicit Binding(Ort::Session& session) : ioBinding(session) {}
+
+    Ort::IoBinding ioBinding;
+    Ort::Value input{nullptr};
+    // Выходы с известной формой выделяются один раз, остальные выделяет ORT при запуске
+    std::vector<Ort::Value> outputs;
+    std::vector<bool> dynamicOutputs;
+    bool hasDynamicOutputs = false;
+};
+
+namespace {
+    struct AsyncCall {
+        OrtModel::Completion completion;
+    };
+
+    void ORT_API_CALL onRunAsyncComplete(void* user_data, OrtValue** /*outputs*/, size_t /*num_outputs*/, OrtStatusPtr status_ptr) {
+        std::unique_ptr<AsyncCall> call(static_cast<AsyncCall*>(user_data));
+        Ort::Status status(status_ptr);
+        std::exception_ptr error;
+        if (!status.IsOK()) {
+            error = std::make_exception_ptr(std::runtime_error("OrtModel: async run failed: " + status.GetErrorMessage()));
+        }
+        call->completion(error);
+    }
+
+    // Первая размерность выхода - батч, если она совпадает с батчем входа:
+    // та же статическая величина или то же имя динамической размерности.
+    // Выходы вида [K, 6] (число найденных рамок) батчем не считаются
+    bool isBatchMajor(const Ort::ConstTensorTypeAndShapeInfo& input, const Ort::ConstTensorTypeAndShapeInfo& output) {
+        auto input_shape = input.GetShape();
+        auto output_shape = output.GetShape();
+        if (input_shape.empty() || output_shape.empty()) return false;
+        if (input_shape[0] > 0 || output_shape[0] > 0) return input_shape[0] == output_shape[0];
+        auto input_names = input.GetSymbolicDimensions();
+        auto output_names = output.GetSymbolicDimensions();
+        return std::string(input_names[0]) == output_names[0];
+    }
+}
+
+OrtModel::OrtModel(
+    Ort::Env& env,
+    const std::string& path,
+    const Ort::SessionOptions& sessionOptions,
+    const std::vector<std::string>& outputNames)
+    : m_outputNames(outputNames) {
+
+    m_session = std::make_unique<Ort::Session>(env, path.c_str(), sessionOptions);
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    m_inputName = m_session->GetInputNameAllocated(0, allocator).get();
+    Ort::TypeInfo input_type_info = m_session->GetInputTypeInfo(0);
+    auto input_info = input_type_info.GetTensorTypeAndShapeInfo();
+    m_inputShape = input_info.GetShape();
+    m_uint8Input = input_info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+
+    if (m_outputNames.empty()) {
+        for (size_t i = 0; i < m_session->GetOutputCount(); ++i) {
+            m_outputNames.push_back(m_session->GetOutputNameAllocated(i, allocator).get());
+        }
+    }
+    for (const auto& name : m_outputNames) {
+        m_outputNamePtrs.push_back(name.c_str());
+    }
+}
+
+OrtModel::~OrtModel() = default;
+
+int64_t OrtModel::batchSize() const {
+    return m_inputShape.empty() || m_inputShape[0] <= 0 ? 0 : m_inputShape[0];
+}
+
+std::vector<int64_t> OrtModel::modelOutputShape(size_t index) const {
+    Ort::AllocatorWithDefaultOptions allocator;
+    const std::string& name = m_outputNames.at(index);
+    for (size_t i = 0; i < m_session->GetOutputCount(); ++i) {
+        if (name != m_session->GetOutputNameAllocated(i, allocator).get()) continue;
+        Ort::TypeInfo type_info = m_session->GetOutputTypeInfo(i);
+        if (type_info.GetONNXType() != ONNX_TYPE_TENSOR) return {};
+        return type_info.GetTensorTypeAndShapeInfo().GetShape();
+    }
+    throw std::runtime_error("OrtModel: model has no output " + name);
+}
+
+OrtModel::Binding& OrtModel::createBinding(const std::vector<int64_t>& shape) {
+    Ort::AllocatorWithDefaultOptions allocator;
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    auto binding = std::make_unique<Binding>(*m_session);
+
+    Ort::TypeInfo input_type_info = m_session->GetInputTypeInfo(0);
+    auto input_info = input_type_info.GetTensorTypeAndShapeInfo();
+    binding->input = Ort::Value::CreateTensor(allocator, shape.data(), shape.size(), input_info.GetElementType());
+    binding->ioBinding.BindInput(m_inputName.c_str(), binding->input);
+
+    // Индексы выходов модели по имени
+    std::map<std::string, size_t> output_indices;
+    for (size_t i = 0; i < m_session->GetOutputCount(); ++i) {
+        output_indices[m_session->GetOutputNameAllocated(i, allocator).get()] = i;
+    }
+
+    for (const auto& name : m_outputNames) {
+        auto it = output_indices.find(name);
+        if (it == output_indices.end()) {
+            throw std::runtime_error("OrtModel: model has no output " + name);
+        }
+
+        Ort::TypeInfo type_info = m_session->GetOutputTypeInfo(it->second);
+        bool is_static = type_info.GetONNXType() == ONNX_TYPE_TENSOR;
+        std::vector<int64_t> output_shape;
+        if (is_static) {
+            auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
+            output_shape = tensor_info.GetShape();
+            if (!output_shape.empty() && output_shape[0] <= 0 && isBatchMajor(input_info, tensor_info)) {
+                output_shape[0] = shape[0];
+            }
+            for (int64_t dim : output_shape) {
+                if (dim <= 0) is_static = false;
+            }
+            if (is_static) {
+                binding->outputs.push_back(Ort::Value::CreateTensor(allocator, output_shape.data(), output_shape.size(), tensor_info.GetElementType()));
+                binding->dynamicOutputs.push_back(false);
+                binding->ioBinding.BindOutput(name.c_str(), binding->outputs.back());
+                continue;
+            }
+        }
+
+        binding->outputs.emplace_back(nullptr);
+        binding->dynamicOutputs.push_back(true);
+        binding->ioBinding.BindOutput(name.c_str(), memory_info);
+        binding->hasDynamicOutputs = true;
+    }
+
+    auto& result = *binding;
+    m_bindings[shape] = std::move(binding);
+    return result;
+}
+
+void* OrtModel::prepareInput(const std::vector<int64_t>& shape) {
+    auto it = m_bindings.find(shape);
+    m_current = it != m_bindings.end() ? it->second.get() : &createBinding(shape);
+    return m_current->input.GetTensorMutableData<void>();
+}
+
+void OrtModel::run() {
+    if (!m_current) {
+        throw std::runtime_error("OrtModel: run() called before prepareInput()");
+    }
+    m_session->Run(Ort::RunOptions{nullptr}, m_current->ioBinding);
+    if (m_current->hasDynamicOutputs) {
+        m_current->outputs = m_current->ioBinding.GetOutputValues();
+    }
+}
+
+void OrtModel::runAsync(Completion completion) {
+    if (!m_current) {
+        throw std::runtime_error("OrtModel: runAsync() called before prepareInput()");
+    }
+    // Пустые значения ORT выделит сам и запишет прямо в outputs
+    for (size_t i = 0; i < m_current->outputs.size(); ++i) {
+        if (m_current->dynamicOutputs[i]) {
+            m_current->outputs[i] = Ort::Value{nullptr};
+        }
+    }
+
+    const char* input_names[] = {m_inputName.c_str()};
+    auto call = std::make_unique<AsyncCall>();
+    call->completion = std::move(completion);
+    try {
+        m_session->RunAsync(Ort::RunOptions{nullptr}, input_names, &m_current->input, 1,
+            m_outputNamePtrs.data(), m_current->outputs.data(), m_outputNamePtrs.size(),
+            onRunAsyncComplete, call.get());
+        call.release();
+    }
+    catch (const Ort::Exception& e) {
+        // RunAsync требует пул intra-op минимум из двух потоков, иначе выполняем синхронно
+        spdlog::debug("OrtModel: RunAsync unavailable ({}), running synchronously", e.what());
+        std::exception_ptr error;
+        try {
+            run();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        call->completion(error);
+    }
+}
+
+const void* OrtModel::outputBuffer(size_t index) const {
+    return m_current->outputs.at(index).GetTensorData<void>();
+}
+
+std::vector<int64_t> OrtModel::outputShape(size_t index) const {
+    return m_current->outputs.at(index).GetTensorTypeAndShapeInfo().GetShape();
+}
@@ -0,0 +1,141 @@
+// PersonTracker.cpp
+
+#include "PersonTracker.h"
+#include <algorithm>
+#include <tuple>
+
+// IoU, начиная с которого детекция продолжает трек
+const float MATCH_IOU = 0.3f;
+// Трек без подтверждения детектором удаляется после стольких ключевых кадров подряд
+const int MAX_KEYFRAME_MISSES = 2;
+// Сетка точек внутри рамки для оптического потока
+const int FLOW_GRID = 8;
+// Наибольшее расхождение прямого и обратного потока (в пикселях), при котором точка считается прослеженной
+const float MAX_FORWARD_BACKWARD_ERROR = 1.0f;
+// Трек удаляется, если в кадре осталось меньше этой доли рамки
+const float MIN_VISIBLE_FRACTION = 0.5f;
+
+namespace {
+    float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+        float inter = (a & b).area();
+        float uni = a.area() + b.area() - inter;
+        return uni > 0.0f ? inter / uni : 0.0f;
+    }
+
+    float median(std::vector<float>& values) {
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    }
+}
+
+void PersonTracker::toGray(const cv::Mat& frame, cv::Mat& gray) const {
+    if (frame.channels() == 3) cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    else frame.copyTo(gray);
+}
+
+std::vector<int> PersonTracker::update(const cv::Mat& frame, const std::vector<cv::Rect>& detections) {
+    // Пары (IoU, трек, детекция) выше порога, лучшие сопоставляются первыми
+    std::vector<std::tuple<float, size_t, size_t>> pairs;
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        for (size_t d = 0; d < detections.size(); ++d) {
+            float overlap = iou(m_tracks[t].box, cv::Rect2f(detections[d]));
+            if (overlap >= MATCH_IOU) {
+                pairs.emplace_back(overlap, t, d);
+            }
+        }
+    }
+    std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a) > std::get<0>(b);
+    });
+
+    std::vector<bool> trackMatched(m_tracks.size(), false);
+    std::vector<bool> detectionMatched(detections.size(), false);
+    std::vector<int> ids(detections.size(), 0);
+    for (const auto& [overlap, t, d] : pairs) {
+        if (trackMatched[t] || detectionMatched[d]) continue;
+        trackMatched[t] = true;
+        detectionMatched[d] = true;
+        m_tracks[t].box = cv::Rect2f(detections[d]);
+        m_tracks[t].confidence = 1.0f;
+        m_tracks[t].misses = 0;
+        ids[d] = m_tracks[t].id;
+    }
+
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        if (!trackMatched[t]) ++m_tracks[t].misses;
+    }
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [](const Track& track) {
+        return track.misses >= MAX_KEYFRAME_MISSES;
+    }), m_tracks.end());
+
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (detectionMatched[d]) continue;
+        Track track;
+        track.id = m_nextId++;
+        ids[d] = track.id;
+        track.box = cv::Rect2f(detections[d]);
+        m_tracks.push_back(track);
+    }
+
+    toGray(frame, m_prevGray);
+    return ids;
+}
+
+float PersonTracker::propagate(const cv::Mat& frame) {
+    toGray(frame, m_gray);
+    if (m_tracks.empty() || m_prevGray.size() != m_gray.size()) {
+        std::swap(m_prevGray, m_gray);
+        return 1.0f;
+    }
+
+    // Точки всех треков прослеживаются одним вызовом
+    const size_t pointsPerTrack = FLOW_GRID * FLOW_GRID;
+    m_points.clear();
+    for (const auto& track : m_tracks) {
+        for (int gy = 0; gy < FLOW_GRID; ++gy) {
+            for (int gx = 0; gx < FLOW_GRID; ++gx) {
+                m_points.emplace_back(
+                    track.box.x + track.box.width * (gx + 0.5f) / FLOW_GRID,
+                    track.box.y + track.box.height * (gy + 0.5f) / FLOW_GRID);
+            }
+        }
+    }
+
+    std::vector<uchar> forwardStatus;
+    std::vector<uchar> backwardStatus;
+    std::vector<float> error;
+    cv::calcOpticalFlowPyrLK(m_prevGray, m_gray, m_points, m_forward, forwardStatus, error);
+    cv::calcOpticalFlowPyrLK(m_gray, m_prevGray, m_forward, m_backward, backwardStatus, error);
+
+    float lowest = 1.0f;
+    std::vector<float> dx;
+    std::vector<float> dy;
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        dx.clear();
+        dy.clear();
+        for (size_t i = t * pointsPerTrack; i < (t + 1) * pointsPerTrack; ++i) {
+            if (!forwardStatus[i] || !backwardStatus[i]) continue;
+            cv::Point2f drift = m_backward[i] - m_points[i];
+            if (drift.dot(drift) > MAX_FORWARD_BACKWARD_ERROR * MAX_FORWARD_BACKWARD_ERROR) continue;
+            dx.push_back(m_forward[i].x - m_points[i].x);
+            dy.push_back(m_forward[i].y - m_points[i].y);
+        }
+
+        Track& track = m_tracks[t];
+        track.confidence = static_cast<float>(dx.size()) / pointsPerTrack;
+        if (!dx.empty()) {
+            track.box.x += median(dx);
+            track.box.y += median(dy);
+        }
+        lowest = std::min(lowest, track.confidence);
+    }
+
+    cv::Rect2f bounds(0.0f, 0.0f, static_cast<float>(m_gray.cols), static_cast<float>(m_gray.rows));
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [&bounds](const Track& track) {
+        return (track.box & bounds).area() < MIN_VISIBLE_FRACTION * track.box.area();
+    }), m_tracks.end());
+
+    std::swap(m_prevGray, m_gray);
+    return lowest;
+}
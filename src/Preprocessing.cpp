@@ -0,0 +1,364 @@
+// Preprocessing.cpp
+
+#include "Preprocessing.h"
+#include <opencv2/dnn.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PREPROCESSING_X86_SIMD 1
+#endif
+
+namespace {
+    const float PIXEL_SCALE = 1.0f / 255.0f;
+
+    // Таблица билинейной интерполяции по одной оси (центры пикселей как в cv::resize)
+    struct AxisTable {
+        std::vector<int> offset0;
+        std::vector<int> offset1;
+        std::vector<float> weight;
+    };
+
+    void buildAxisTable(int src_size, int dst_size, int stride, AxisTable& table) {
+        table.offset0.resize(dst_size);
+        table.offset1.resize(dst_size);
+        table.weight.resize(dst_size);
+
+        float scale = src_size / static_cast<float>(dst_size);
+        for (int i = 0; i < dst_size; ++i) {
+            float position = (i + 0.5f) * scale - 0.5f;
+            int index = static_cast<int>(std::floor(position));
+            float weight = position - index;
+            if (index < 0) {
+                index = 0;
+                weight = 0.0f;
+            }
+            if (index >= src_size - 1) {
+                index = src_size - 1;
+                weight = 0.0f;
+            }
+            table.offset0[i] = index * stride;
+            table.offset1[i] = std::min(index + 1, src_size - 1) * stride;
+            table.weight[i] = weight;
+        }
+    }
+
+    // Строка результата: x из [x_begin, x_end), planes - плоскости R, G, B этой строки
+    using RowKernel = int (*)(const uint8_t* row0, const uint8_t* row1, float fy,
+        const int* x_offset0, const int* x_offset1, const float* fx,
+        int x_begin, int x_end, float* r, float* g, float* b);
+
+    int resizeRowScalar(const uint8_t* row0, const uint8_t* row1, float fy,
+        const int* x_offset0, const int* x_offset1, const float* fx,
+        int x_begin, int x_end, float* r, float* g, float* b) {
+        float* planes[3] = {b, g, r};
+        for (int x = x_begin; x < x_end; ++x) {
+            const uint8_t* p00 = row0 + x_offset0[x];
+            const uint8_t* p01 = row0 + x_offset1[x];
+            const uint8_t* p10 = row1 + x_offset0[x];
+            const uint8_t* p11 = row1 + x_offset1[x];
+            for (int c = 0; c < 3; ++c) {
+                float top = p00[c] + (p01[c] - p00[c]) * fx[x];
+                float bottom = p10[c] + (p11[c] - p10[c]) * fx[x];
+                planes[c][x] = (top + (bottom - top) * fy) * PIXEL_SCALE;
+            }
+        }
+        return x_end;
+    }
+
+#ifdef PREPROCESSING_X86_SIMD
+    // Векторные версии читают пиксель одним 32-битным gather (B, G, R и байт следующего пикселя),
+    // поэтому обрабатывают только x, для которых чтение не выходит за конец строки.
+    // Возвращают первый необработанный x, остаток досчитывает скалярная версия.
+
+    __attribute__((target("avx2,fma")))
+    int resizeRowAvx2(const uint8_t* row0, const uint8_t* row1, float fy,
+        const int* x_offset0, const int* x_offset1, const float* fx,
+        int x_begin, int x_end, float* r, float* g, float* b) {
+        const __m256i mask = _mm256_set1_epi32(0xFF);
+        const __m256 wy = _mm256_set1_ps(fy);
+        const __m256 scale = _mm256_set1_ps(PIXEL_SCALE);
+        float* planes[3] = {b, g, r};
+
+        int x = x_begin;
+        for (; x + 8 <= x_end; x += 8) {
+            __m256i o0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x_offset0 + x));
+            __m256i o1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x_offset1 + x));
+            __m256i v00 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(row0), o0, 1);
+            __m256i v01 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(row0), o1, 1);
+            __m256i v10 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(row1), o0, 1);
+            __m256i v11 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(row1), o1, 1);
+            __m256 wx = _mm256_loadu_ps(fx + x);
+
+            for (int c = 0; c < 3; ++c) {
+                __m256 p00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v00, 8 * c), mask));
+                __m256 p01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v01, 8 * c), mask));
+                __m256 p10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v10, 8 * c), mask));
+                __m256 p11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v11, 8 * c), mask));
+                __m256 top = _mm256_fmadd_ps(_mm256_sub_ps(p01, p00), wx, p00);
+                __m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(p11, p10), wx, p10);
+                __m256 value = _mm256_fmadd_ps(_mm256_sub_ps(bottom, top), wy, top);
+                _mm256_storeu_ps(planes[c] + x, _mm256_mul_ps(value, scale));
+            }
+        }
+        return x;
+    }
+
+    __attribute__((target("avx512f")))
+    int resizeRowAvx512(const uint8_t* row0, const uint8_t* row1, float fy,
+        const int* x_offset0, const int* x_offset1, const float* fx,
+        int x_begin, int x_end, float* r, float* g, float* b) {
+        const __m512i mask = _mm512_set1_epi32(0xFF);
+        const __m512 wy = _mm512_set1_ps(fy);
+        const __m512 scale = _mm512_set1_ps(PIXEL_SCALE);
+        float* planes[3] = {b, g, r};
+
+        int x = x_begin;
+        for (; x + 16 <= x_end; x += 16) {
+            __m512i o0 = _mm512_loadu_si512(x_offset0 + x);
+            __m512i o1 = _mm512_loadu_si512(x_offset1 + x);
+            __m512i v00 = _mm512_i32gather_epi32(o0, row0, 1);
+            __m512i v01 = _mm512_i32gather_epi32(o1, row0, 1);
+            __m512i v10 = _mm512_i32gather_epi32(o0, row1, 1);
+            __m512i v11 = _mm512_i32gather_epi32(o1, row1, 1);
+            __m512 wx = _mm512_loadu_ps(fx + x);
+
+            for (int c = 0; c < 3; ++c) {
+                __m512 p00 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v00, 8 * c), mask));
+                __m512 p01 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v01, 8 * c), mask));
+                __m512 p10 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v10, 8 * c), mask));
+                __m512 p11 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v11, 8 * c), mask));
+                __m512 top = _mm512_fmadd_ps(_mm512_sub_ps(p01, p00), wx, p00);
+                __m512 bottom = _mm512_fmadd_ps(_mm512_sub_ps(p11, p10), wx, p10);
+                __m512 value = _mm512_fmadd_ps(_mm512_sub_ps(bottom, top), wy, top);
+                _mm512_storeu_ps(planes[c] + x, _mm512_mul_ps(value, scale));
+            }
+        }
+        // Хвост короче 16 пикселей добирает AVX2
+        return resizeRowAvx2(row0, row1, fy, x_offset0, x_offset1, fx, x, x_end, r, g, b);
+    }
+#endif
+
+    struct KernelInfo {
+        RowKernel kernel;
+        const char* name;
+    };
+
+    KernelInfo selectKernel() {
+#ifdef PREPROCESSING_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return {resizeRowAvx512, "avx512"};
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return {resizeRowAvx2, "avx2"};
+        }
+#endif
+        return {resizeRowScalar, "scalar"};
+    }
+
+    const KernelInfo& kernelInfo() {
+        static const KernelInfo info = selectKernel();
+        return info;
+    }
+
+    // Цвет полей letterbox, как при обучении YOLO
+    const uint8_t LETTERBOX_PAD_BYTE = 114;
+    const float LETTERBOX_PAD_VALUE = LETTERBOX_PAD_BYTE * PIXEL_SCALE;
+    // Кэш таблиц сбрасывается целиком, когда геометрий становится слишком много (вырезы людей и кистей)
+    const size_t MAX_CACHED_GEOMETRIES = 64;
+
+    // Таблицы resize для одной геометрии: размер и шаг строки источника, размер результата
+    struct ResizeTables {
+        AxisTable x;
+        AxisTable y;
+        // Первый x, который векторное ядро уже не может обработать
+        int vectorEnd = 0;
+    };
+
+    using GeometryKey = std::tuple<int, int, size_t, int, int>;
+
+    // Кадры ROI камер имеют постоянную геометрию, поэтому таблицы строятся один раз на камеру
+    const ResizeTables& resizeTables(const cv::Mat& image, const cv::Size& size) {
+        thread_local std::map<GeometryKey, ResizeTables> cache;
+
+        GeometryKey key{image.cols, image.rows, image.step[0], size.width, size.height};
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        if (cache.size() >= MAX_CACHED_GEOMETRIES) {
+            cache.clear();
+        }
+
+        ResizeTables& tables = cache[key];
+        buildAxisTable(image.cols, size.width, 3, tables.x);
+        buildAxisTable(image.rows, size.height, static_cast<int>(image.step[0]), tables.y);
+
+        // Векторное ядро читает 4 байта с начала пикселя, поэтому последний пиксель строки - только скалярно
+        int row_bytes = image.cols * 3;
+        tables.vectorEnd = static_cast<int>(std::upper_bound(tables.x.offset1.begin(), tables.x.offset1.end(), row_bytes - 4)
+            - tables.x.offset1.begin());
+        return tables;
+    }
+
+    // Прямоугольник вписанного изображения внутри входа size, заполняет transform
+    cv::Rect letterboxTarget(const cv::Size& image_size, const cv::Size& size, LetterboxTransform& transform) {
+        float scale = std::min(size.width / static_cast<float>(image_size.width), size.height / static_cast<float>(image_size.height));
+        cv::Size content(
+            std::clamp(static_cast<int>(std::round(image_size.width * scale)), 1, size.width),
+            std::clamp(static_cast<int>(std::round(image_size.height * scale)), 1, size.height));
+        cv::Rect target(cv::Point((size.width - content.width) / 2, (size.height - content.height) / 2), content);
+        transform.scaleX = content.width / static_cast<float>(image_size.width);
+        transform.scaleY = content.height / static_cast<float>(image_size.height);
+        transform.offset = cv::Point2f(static_cast<float>(target.x), static_cast<float>(target.y));
+        return target;
+    }
+
+    // Resize в прямоугольник target внутри плоскостей размера plane_size
+    void resizeInto(const cv::Mat& image, const cv::Rect& target, const cv::Size& plane_size, float* blob) {
+        const ResizeTables& tables = resizeTables(image, target.size());
+        const RowKernel kernel = kernelInfo().kernel;
+
+        size_t plane_length = static_cast<size_t>(plane_size.width) * plane_size.height;
+        float* r_plane = blob;
+        float* g_plane = blob + plane_length;
+        float* b_plane = blob + 2 * plane_length;
+
+        for (int y = 0; y < target.height; ++y) {
+            const uint8_t* row0 = image.data + tables.y.offset0[y];
+            const uint8_t* row1 = image.data + tables.y.offset1[y];
+            size_t row_offset = static_cast<size_t>(target.y + y) * plane_size.width + target.x;
+            float* r = r_plane + row_offset;
+            float* g = g_plane + row_offset;
+            float* b = b_plane + row_offset;
+
+            int x = kernel(row0, row1, tables.y.weight[y], tables.x.offset0.data(), tables.x.offset1.data(),
+                tables.x.weight.data(), 0, tables.vectorEnd, r, g, b);
+            resizeRowScalar(row0, row1, tables.y.weight[y], tables.x.offset0.data(), tables.x.offset1.data(),
+                tables.x.weight.data(), x, target.width, r, g, b);
+        }
+    }
+}
+
+cv::Point2f LetterboxTransform::toSource(const cv::Point2f& point) const {
+    return cv::Point2f((point.x - offset.x) / scaleX, (point.y - offset.y) / scaleY);
+}
+
+cv::Rect2f LetterboxTransform::toSource(const cv::Rect2f& rect) const {
+    return cv::Rect2f(toSource(rect.tl()), toSource(rect.br()));
+}
+
+const char* preprocessingKernelName() {
+    return kernelInfo().name;
+}
+
+void blobFromImageFused(const cv::Mat& image, const cv::Size& size, float* blob) {
+    // Ядро рассчитано на 8-битные BGR кадры камер, остальное идёт через OpenCV
+    if (image.type() != CV_8UC3 || image.empty()) {
+        int blob_sizes[] = {1, 3, size.height, size.width};
+        cv::Mat target(4, blob_sizes, CV_32F, blob);
+        cv::dnn::blobFromImage(image, target, PIXEL_SCALE, size, cv::Scalar(), true, false);
+        return;
+    }
+    resizeInto(image, cv::Rect(cv::Point(0, 0), size), size, blob);
+}
+
+void blobFromImagesFused(const std::vector<cv::Mat>& images, const cv::Size& size, float* blob) {
+    size_t image_size = 3 * static_cast<size_t>(size.width) * size.height;
+    for (size_t i = 0; i < images.size(); ++i) {
+        blobFromImageFused(images[i], size, blob + i * image_size);
+    }
+}
+
+LetterboxTransform letterboxFromImageFused(const cv::Mat& image, const cv::Size& size, float* blob) {
+    LetterboxTransform transform;
+    if (image.empty()) {
+        std::fill(blob, blob + 3 * static_cast<size_t>(size.width) * size.height, LETTERBOX_PAD_VALUE);
+        return transform;
+    }
+
+    cv::Rect target = letterboxTarget(image.size(), size, transform);
+    cv::Size content = target.size();
+
+    // Поля заполняются только вокруг изображения
+    size_t plane_length = static_cast<size_t>(size.width) * size.height;
+    for (int c = 0; c < 3; ++c) {
+        float* plane = blob + c * plane_length;
+        std::fill(plane, plane + static_cast<size_t>(target.y) * size.width, LETTERBOX_PAD_VALUE);
+        for (int y = target.y; y < target.y + target.height; ++y) {
+            float* row = plane + static_cast<size_t>(y) * size.width;
+            std::fill(row, row + target.x, LETTERBOX_PAD_VALUE);
+            std::fill(row + target.x + target.width, row + size.width, LETTERBOX_PAD_VALUE);
+        }
+        std::fill(plane + static_cast<size_t>(target.y + target.height) * size.width, plane + plane_length, LETTERBOX_PAD_VALUE);
+    }
+
+    if (image.type() == CV_8UC3) {
+        resizeInto(image, target, size, blob);
+    }
+    else {
+        // Редкий случай не-BGR кадра: OpenCV готовит вписанную часть, затем она копируется построчно
+        cv::Mat content_blob;
+        cv::dnn::blobFromImage(image, content_blob, PIXEL_SCALE, content, cv::Scalar(), true, false);
+        const float* source = content_blob.ptr<float>();
+        for (int c = 0; c < 3; ++c) {
+            for (int y = 0; y < content.height; ++y) {
+                std::copy_n(source + (static_cast<size_t>(c) * content.height + y) * content.width, content.width,
+                    blob + c * plane_length + static_cast<size_t>(target.y + y) * size.width + target.x);
+            }
+        }
+    }
+    return transform;
+}
+
+std::vector<LetterboxTransform> letterboxFromImagesFused(const std::vector<cv::Mat>& images, const cv::Size& size, float* blob) {
+    std::vector<LetterboxTransform> transforms;
+    transforms.reserve(images.size());
+    size_t image_size = 3 * static_cast<size_t>(size.width) * size.height;
+    for (size_t i = 0; i < images.size(); ++i) {
+        transforms.push_back(letterboxFromImageFused(images[i], size, blob + i * image_size));
+    }
+    return transforms;
+}
+
+LetterboxTransform letterboxFromImageU8(const cv::Mat& image, const cv::Size& size, uint8_t* blob) {
+    LetterboxTransform transform;
+    cv::Mat input(size, CV_8UC3, blob);
+    if (image.empty()) {
+        input.setTo(cv::Scalar::all(LETTERBOX_PAD_BYTE));
+        return transform;
+    }
+    if (image.type() != CV_8UC3) {
+        throw std::runtime_error("Preprocessing: uint8 input expects 8-bit BGR images");
+    }
+
+    cv::Rect target = letterboxTarget(image.size(), size, transform);
+
+    // Поля заполняются только вокруг изображения
+    input.rowRange(0, target.y).setTo(cv::Scalar::all(LETTERBOX_PAD_BYTE));
+    input.rowRange(target.y + target.height, size.height).setTo(cv::Scalar::all(LETTERBOX_PAD_BYTE));
+    input(cv::Rect(0, target.y, target.x, target.height)).setTo(cv::Scalar::all(LETTERBOX_PAD_BYTE));
+    input(cv::Rect(target.x + target.width, target.y, size.width - target.x - target.width, target.height))
+        .setTo(cv::Scalar::all(LETTERBOX_PAD_BYTE));
+
+    // Память content принадлежит тензору, поэтому resize пишет прямо во вход модели
+    cv::Mat content = input(target);
+    cv::resize(image, content, target.size(), 0, 0, cv::INTER_LINEAR);
+    return transform;
+}
+
+std::vector<LetterboxTransform> letterboxFromImagesU8(const std::vector<cv::Mat>& images, const cv::Size& size, uint8_t* blob) {
+    std::vector<LetterboxTransform> transforms;
+    transforms.reserve(images.size());
+    size_t image_size = 3 * static_cast<size_t>(size.width) * size.height;
+    for (size_t i = 0; i < images.size(); ++i) {
+        transforms.push_back(letterboxFromImageU8(images[i], size, blob + i * image_size));
+    }
+    return transforms;
+}
@@ -0,0 +1,165 @@
+// SessionPool.cpp
+
+#include "SessionPool.h"
+#include "OrtEnvironment.h"
+#include <onnxruntime_cxx_api.h>
+#include <algorithm>
+#include <stdexcept>
+#include "spdlog/spdlog.h"
+
+SessionPool::Lease::~Lease() {
+    if (m_pool) {
+        m_pool->checkin(m_index);
+    }
+}
+
+SessionPool::Lease::Lease(Lease&& other) noexcept
+    : m_pool(other.m_pool), m_index(other.m_index) {
+    other.m_pool = nullptr;
+}
+
+SessionPool::SessionPool(
+    const std::string& name,
+    const std::string& path,
+    const ModelConfig& config,
+    const std::vector<std::string>& outputNames,
+    bool allowCuda)
+    : m_name(name), m_config(config) {
+
+    // Хотя бы одна реплика всегда остаётся общей
+    size_t replicas = std::max<size_t>(1, config.replicas);
+    if (replicas <= config.pinnedCameras.size()) {
+        spdlog::warn("{}: {} replicas is not enough for {} pinned cameras, using {}",
+            name, replicas, config.pinnedCameras.size(), config.pinnedCameras.size() + 1);
+        replicas = config.pinnedCameras.size() + 1;
+    }
+
+    Ort::SessionOptions sessionOptions = OrtEnvironment::getInstance().createSessionOptions(name, config, allowCuda);
+    for (size_t i = 0; i < replicas; ++i) {
+        m_replicas.push_back(std::make_unique<OrtModel>(OrtEnvironment::getInstance().getEnv(), path, sessionOptions, outputNames));
+    }
+    m_busy.assign(replicas, false);
+
+    m_uint8Input = config.inputFormat == "uint8_nhwc";
+    if (!m_uint8Input && config.inputFormat != "float_nchw") {
+        throw std::runtime_error(name + ": unknown input_format " + config.inputFormat);
+    }
+    if (m_uint8Input != model().hasUint8Input()) {
+        throw std::runtime_error(name + ": input_format " + config.inputFormat + " does not match model input type");
+    }
+
+    for (size_t i = 0; i < config.pinnedCameras.size(); ++i) {
+        m_pinnedReplicas[config.pinnedCameras[i]] = i;
+        spdlog::info("{}: replica {} pinned to camera ID {}", name, i, config.pinnedCameras[i]);
+    }
+    for (size_t i = config.pinnedCameras.size(); i < replicas; ++i) {
+        m_sharedReplicas.push_back(i);
+    }
+    spdlog::info("{}: {} replicas ({} shared)", name, replicas, m_sharedReplicas.size());
+}
+
+SessionPool::~SessionPool() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] {
+        return std::none_of(m_busy.begin(), m_busy.end(), [](bool busy) { return busy; });
+    });
+}
+
+int64_t SessionPool::batchSize() const {
+    int64_t model_batch = model().batchSize();
+    if (model_batch > 0) return model_batch;
+    return std::max(0, m_config.batchSize);
+}
+
+int SessionPool::inputSize(int fallback) const {
+    // Фиксированный размер модели важнее конфигурации
+    const auto& shape = model().inputShape();
+    size_t height_axis = m_uint8Input ? 1 : 2;
+    if (shape.size() == 4 && shape[height_axis] > 0) return static_cast<int>(shape[height_axis]);
+    if (m_config.inputSize > 0) return m_config.inputSize;
+    return fallback;
+}
+
+bool SessionPool::dynamicSpatialShape() const {
+    const auto& shape = model().inputShape();
+    size_t height_axis = m_uint8Input ? 1 : 2;
+    return shape.size() == 4 && shape[height_axis] <= 0 && shape[height_axis + 1] <= 0;
+}
+
+std::vector<LetterboxTransform> SessionPool::prepareImages(OrtModel& replica, const std::vector<cv::Mat>& images, const cv::Size& inputSize) const {
+    int64_t count = static_cast<int64_t>(images.size());
+    // Модель с фиксированным батчем принимает только полный батч, недостающие места заполняются нулями
+    int64_t batch = std::max(count, replica.batchSize());
+    size_t image_length = static_cast<size_t>(inputSize.height) * inputSize.width * 3;
+    if (m_uint8Input) {
+        uint8_t* blob = replica.prepareInput<uint8_t>({batch, inputSize.height, inputSize.width, 3});
+        std::fill(blob + count * image_length, blob + batch * image_length, uint8_t(0));
+        return letterboxFromImagesU8(images, inputSize, blob);
+    }
+    float* blob = replica.prepareInput<float>({batch, 3, inputSize.height, inputSize.width});
+    std::fill(blob + count * image_length, blob + batch * image_length, 0.0f);
+    return letterboxFromImagesFused(images, inputSize, blob);
+}
+
+void SessionPool::warmup(const std::vector<cv::Size>& inputSizes, int64_t maxBatch) {
+    int64_t model_batch = model().batchSize();
+    int64_t min_batch = model_batch > 0 ? model_batch : 1;
+    int64_t max_batch = model_batch > 0 ? model_batch : std::max<int64_t>(1, maxBatch);
+    if (model_batch <= 0 && m_config.batchSize > 0) {
+        max_batch = std::min<int64_t>(max_batch, m_config.batchSize);
+    }
+
+    for (size_t index = 0; index < m_replicas.size(); ++index) {
+        Lease replica = checkoutReplica(index);
+        for (const auto& size : inputSizes) {
+            for (int64_t batch = min_batch; batch <= max_batch; ++batch) {
+                std::vector<cv::Mat> images(batch, cv::Mat::zeros(size, CV_8UC3));
+                prepareImages(*replica, images, size);
+                replica->run();
+            }
+        }
+    }
+    spdlog::info("{}: warmed up {} input shapes x batch {}-{} on {} replicas",
+        m_name, inputSizes.size(), min_batch, max_batch, m_replicas.size());
+}
+
+bool SessionPool::isPinned(int cameraId) const {
+    return m_pinnedReplicas.count(cameraId) > 0;
+}
+
+SessionPool::Lease SessionPool::checkoutReplica(size_t index) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this, index] { return !m_busy[index]; });
+    m_busy[index] = true;
+    return Lease(this, index);
+}
+
+SessionPool::Lease SessionPool::checkout(int cameraId) {
+    // Закрепление не меняется после конструктора, блокировка для поиска не нужна
+    auto pinned = m_pinnedReplicas.find(cameraId);
+    if (pinned != m_pinnedReplicas.end()) {
+        return checkoutReplica(pinned->second);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    size_t index = 0;
+    m_cv.wait(lock, [this, &index] {
+        for (size_t candidate : m_sharedReplicas) {
+            if (!m_busy[candidate]) {
+                index = candidate;
+                return true;
+            }
+        }
+        return false;
+    });
+    m_busy[index] = true;
+    return Lease(this, index);
+}
+
+void SessionPool::checkin(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy[index] = false;
+    }
+    m_cv.notify_all();
+}
@@ -0,0 +1,121 @@
+// YoloDecoder.cpp
+
+#include "YoloDecoder.h"
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define YOLO_DECODER_X86_SIMD 1
+#endif
+
+namespace {
+    // Индексы i из [begin, end), для которых row[i] > threshold, дописываются в indices
+    using ThresholdKernel = void (*)(const float* row, int begin, int end, float threshold, std::vector<int>& indices);
+
+    void thresholdScalar(const float* row, int begin, int end, float threshold, std::vector<int>& indices) {
+        for (int i = begin; i < end; ++i) {
+            if (row[i] > threshold) {
+                indices.push_back(i);
+            }
+        }
+    }
+
+#ifdef YOLO_DECODER_X86_SIMD
+    // Почти все предложения ниже порога, поэтому разбор маски - редкая ветка
+
+    __attribute__((target("avx2")))
+    void thresholdAvx2(const float* row, int begin, int end, float threshold, std::vector<int>& indices) {
+        const __m256 limit = _mm256_set1_ps(threshold);
+        int i = begin;
+        for (; i + 8 <= end; i += 8) {
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row + i), limit, _CMP_GT_OQ)));
+            while (mask) {
+                indices.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        thresholdScalar(row, i, end, threshold, indices);
+    }
+
+    __attribute__((target("avx512f")))
+    void thresholdAvx512(const float* row, int begin, int end, float threshold, std::vector<int>& indices) {
+        const __m512 limit = _mm512_set1_ps(threshold);
+        int i = begin;
+        for (; i + 16 <= end; i += 16) {
+            uint32_t mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(row + i), limit, _CMP_GT_OQ);
+            while (mask) {
+                indices.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        thresholdScalar(row, i, end, threshold, indices);
+    }
+#endif
+
+    struct KernelInfo {
+        ThresholdKernel kernel;
+        const char* name;
+    };
+
+    KernelInfo selectKernel() {
+#ifdef YOLO_DECODER_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return {thresholdAvx512, "avx512"};
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return {thresholdAvx2, "avx2"};
+        }
+#endif
+        return {thresholdScalar, "scalar"};
+    }
+
+    const KernelInfo& kernelInfo() {
+        static const KernelInfo info = selectKernel();
+        return info;
+    }
+}
+
+const char* yoloDecoderKernelName() {
+    return kernelInfo().name;
+}
+
+std::vector<Detection> decodeYoloClass(
+    const float* output,
+    int num_proposals,
+    int num_classes,
+    int class_id,
+    float score_threshold) {
+
+    std::vector<Detection> detections;
+    if (class_id < 0 || class_id >= num_classes) return detections;
+
+    // Непрерывный проход по строке оценок нужного класса
+    const float* class_row = output + static_cast<size_t>(4 + class_id) * num_proposals;
+    thread_local std::vector<int> candidates;
+    candidates.clear();
+    kernelInfo().kernel(class_row, 0, num_proposals, score_threshold, candidates);
+
+    for (int i : candidates) {
+        float score = class_row[i];
+
+        // argmax как у cv::minMaxLoc: при равенстве побеждает класс с меньшим номером
+        bool is_best = true;
+        for (int c = 0; c < num_classes && is_best; ++c) {
+            float other = output[static_cast<size_t>(4 + c) * num_proposals + i];
+            is_best = c < class_id ? other < score : (c == class_id || other <= score);
+        }
+        if (!is_best) continue;
+
+        float cx = output[i];
+        float cy = output[num_proposals + i];
+        float w = output[2 * static_cast<size_t>(num_proposals) + i];
+        float h = output[3 * static_cast<size_t>(num_proposals) + i];
+        detections.push_back({
+            cv::Rect2f(cx - 0.5f * w, cy - 0.5f * h, w, h),
+            score,
+            i
+        });
+    }
+    return detections;
+}
@@ -5,7 +5,9 @@
 #include "SystemState.h"
 #include "ConfigManager.h"
 #include "HumanDetector.h"
+#include "InferenceScheduler.h"
 #include "GestureRecognizer.h"
+#include "AutoTuner.h"
 #include "spdlog/spdlog.h"
 
 #include <opencv2/highgui.hpp>
@@ -14,24 +16,55 @@
 #include <vector>
 #include <memory>
 #include <filesystem>
+#include <chrono>
+#include <string>
 
 int main(int argc, char** argv) {
     std::filesystem::path executable_path(argv[0]);
     std::filesystem::path project_root = executable_path.parent_path().parent_path();
 
     std::filesystem::path config_path = project_root / "config.json";
+    std::filesystem::path profile_path = project_root / "tuning_profile.json";
+
+    // --autotune [каталог с кадрами] - подбор настроек инференса вместо обычного запуска
+    bool autotune = argc > 1 && std::string(argv[1]) == "--autotune";
+    std::string autotune_frames = autotune && argc > 2 ? argv[2] : "";
 
     spdlog::info("--- Smart Lightning System Starting ---");
     try {
         ConfigManager::getInstance().load(config_path.string());
         spdlog::info("Configuration loaded successfully");
+
+        if (autotune) {
+            AutoTuner tuner(autotune_frames.empty() ? std::vector<cv::Mat>{} : AutoTuner::loadFrames(autotune_frames));
+            tuner.addModel("detector", (project_root / "models/human_recognizer.onnx").string());
+            tuner.addModel("body_pose", (project_root / "models/gesture_recognizer.onnx").string());
+            tuner.addModel("hand_pose", (project_root / "models/hand_model.onnx").string());
+            tuner.addModel("classifier", (project_root / "models/gesture_classifier.onnx").string(), false);
+            tuner.run();
+            tuner.save(profile_path.string());
+            return 0;
+        }
+        if (ConfigManager::getInstance().loadTuningProfile(profile_path.string())) {
+            spdlog::info("Tuning profile loaded from {}", profile_path.string());
+        }
+
         auto systemState = std::make_shared<SystemState>(); 
         auto httpClient = std::make_shared<HttpClient>();
-        auto humanDetector = std::make_shared<HumanDetector>();
-        auto gestureRecognizer = std::make_shared<GestureRecognizer>();
+        auto humanDetector = std::make_unique<HumanDetector>();
+        auto gestureRecognizer = std::make_unique<GestureRecognizer>();
 
         // Загруза моделей
         humanDetector->loadModel((project_root / "models/human_recognizer.onnx").string()); 
+        // Формы входа детектора зависят от ROI камер, их подготовка выполняется до первого кадра
+        std::vector<cv::Size> roiSizes;
+        for (const auto& camConfig : ConfigManager::getInstance().getCameraConfigs()) {
+            // Камеры в однопроходном режиме детектор не используют
+            if (!camConfig.singlePass) {
+                roiSizes.emplace_back(camConfig.roi[2], camConfig.roi[3]);
+            }
+        }
+        humanDetector->warmup(roiSizes, ConfigManager::getInstance().getDetectorBatchSize());
         // Модель для общей позы тела
         gestureRecognizer->loadBodyPoseModel((project_root / "models/gesture_recognizer.onnx").string()); 
         // Модель для точек кисти
@@ -45,13 +78,22 @@ int main(int argc, char** argv) {
         const auto& cameraConfigs = ConfigManager::getInstance().getCameraConfigs();
         spdlog::info("Found {} cameras", cameraConfigs.size());
 
+        // Планировщик владеет моделями и делит инференс между камерами
+        auto inferenceScheduler = std::make_shared<InferenceScheduler>(
+            std::move(humanDetector),
+            std::move(gestureRecognizer),
+            cameraConfigs,
+            ConfigManager::getInstance().getDetectorBatchSize(),
+            ConfigManager::getInstance().getDetectorBatchTimeout(),
+            ConfigManager::getInstance().getSchedulerWorkers()
+        );
+
         for (const auto& camConfig : cameraConfigs) {
             auto processor = std::make_unique<CameraProcessor>(
                 camConfig,
                 systemState,
                 httpClient,
-                humanDetector,
-                gestureRecognizer
+                inferenceScheduler
             );
             cameraThreads.emplace_back(&CameraProcessor::run, processor.get());
             cameraProcessors.push_back(std::move(processor));
@@ -59,6 +101,7 @@ int main(int argc, char** argv) {
 
         std::cout << "\n--- System is running ---\n";
 
+        auto lastStatsTime = std::chrono::steady_clock::now();
         while(true){
             for(const auto& processor : cameraProcessors){
                 cv::Mat frame = processor->getLatestFrame();
@@ -68,6 +111,21 @@ int main(int argc, char** argv) {
                 }
             }
 
+            // Периодический вывод состояния очередей планировщика
+            if (std::chrono::steady_clock::now() - lastStatsTime > std::chrono::seconds(30)) {
+                for (const auto& [cameraId, stats] : inferenceScheduler->getAllStats()) {
+                    spdlog::info("Camera ID {} | queue depth {}, avg wait {:.1f} ms, last wait {:.1f} ms, served {}",
+                        cameraId, stats.queueDepth, stats.avgWaitMs, stats.lastWaitMs, stats.servedJobs);
+                }
+                for (const auto& processor : cameraProcessors) {
+                    MotionGateStats motion = processor->getMotionStats();
+                    spdlog::info("Camera ID {} | motion gate: detector ran {} (motion {}, keep-alive {}, gesture hold {}), skipped {}, last motion {:.4f}",
+                        processor->getConfig().id, motion.opened + motion.keepAlive + motion.held, motion.opened, motion.keepAlive,
+                        motion.held, motion.skipped, motion.lastMotion);
+                }
+                lastStatsTime = std::chrono::steady_clock::now();
+            }
+
             int key = cv::waitKey(33);
             if (key == 'q' || key == 27){
                 break;
@@ -82,9 +140,11 @@ int main(int argc, char** argv) {
                 t.join();
             }
         }
+        inferenceScheduler->stop();
         cv::destroyAllWindows();
     }
-    catch (const std::runtime_error& e) {
+    catch (const std::exception& e) {
+        // Включая Ort::Exception из загрузки и прогрева моделей
         spdlog::error("Error: {}", e.what());
         return 1;
     }
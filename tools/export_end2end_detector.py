@@ -0,0 +1,113 @@
+"""Добавляет в ONNX-детектор YOLOv8 разбор предложений и NMS, чтобы модель выдавала готовые рамки людей.
+
+Выход output0 [1, 4 + nc, N] заменяется на output0 [K, 6] со строками
+(номер кадра в батче, x1, y1, x2, y2, score) в координатах входа модели.
+Предложение остаётся, только если класс людей - класс с наибольшей оценкой (как в HumanDetector).
+HumanDetector распознаёт такую модель по форме выхода и пропускает разбор на CPU.
+
+Запуск: python tools/export_end2end_detector.py models/human_recognizer.onnx models/human_recognizer_e2e.onnx
+Требуется пакет onnx.
+"""
+import argparse
+
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+import numpy as np
+
+
+def constant(name, values, dtype):
+    return numpy_helper.from_array(np.array(values, dtype=dtype), name)
+
+
+def append_postprocessing(model, class_id, score_threshold, iou_threshold, max_detections):
+    graph = model.graph
+    opset = next((o.version for o in model.opset_import if o.domain in ('', 'ai.onnx')), 0)
+    if opset < 11:
+        raise ValueError(f'opset {opset} < 11: GatherND и NonMaxSuppression недоступны')
+
+    output = next((o for o in graph.output if o.name == 'output0'), graph.output[0])
+    name = output.name
+    raw = name + '_raw'
+    for node in graph.node:
+        node.output[:] = [raw if o == name else o for o in node.output]
+        node.input[:] = [raw if i == name else i for i in node.input]
+    graph.output.remove(output)
+
+    graph.initializer.extend([
+        constant('e2e_boxes_start', [0], np.int64),
+        constant('e2e_boxes_end', [4], np.int64),
+        constant('e2e_scores_end', [1 << 62], np.int64),
+        constant('e2e_class_start', [4 + class_id], np.int64),
+        constant('e2e_class_end', [5 + class_id], np.int64),
+        constant('e2e_axis_1', [1], np.int64),
+        constant('e2e_axis_2', [2], np.int64),
+        constant('e2e_xy_start', [0], np.int64),
+        constant('e2e_xy_end', [2], np.int64),
+        constant('e2e_wh_end', [4], np.int64),
+        constant('e2e_half', [0.5], np.float32),
+        constant('e2e_zero', [0.0], np.float32),
+        constant('e2e_class_index', [class_id], np.int64),
+        constant('e2e_max_detections', [max_detections], np.int64),
+        constant('e2e_iou_threshold', [iou_threshold], np.float32),
+        constant('e2e_score_threshold', [score_threshold], np.float32),
+        constant('e2e_batch_box_columns', [0, 2], np.int64),
+        constant('e2e_column', [-1, 1], np.int64),
+    ])
+
+    graph.node.extend([
+        # Рамки [B, N, 4] в формате (cx, cy, w, h)
+        helper.make_node('Slice', [raw, 'e2e_boxes_start', 'e2e_boxes_end', 'e2e_axis_1'], ['e2e_boxes_cxcywh_t']),
+        helper.make_node('Transpose', ['e2e_boxes_cxcywh_t'], ['e2e_boxes_cxcywh'], perm=[0, 2, 1]),
+
+        # Оценка людей [B, 1, N], обнулённая там, где argmax по классам не класс людей
+        helper.make_node('Slice', [raw, 'e2e_boxes_end', 'e2e_scores_end', 'e2e_axis_1'], ['e2e_class_scores']),
+        helper.make_node('ArgMax', ['e2e_class_scores'], ['e2e_best_class'], axis=1, keepdims=1),
+        helper.make_node('Equal', ['e2e_best_class', 'e2e_class_index'], ['e2e_is_person']),
+        helper.make_node('Slice', [raw, 'e2e_class_start', 'e2e_class_end', 'e2e_axis_1'], ['e2e_person_scores_all']),
+        helper.make_node('Where', ['e2e_is_person', 'e2e_person_scores_all', 'e2e_zero'], ['e2e_person_scores']),
+
+        # selected [K, 3] = (номер кадра, класс 0, номер предложения)
+        helper.make_node('NonMaxSuppression',
+                         ['e2e_boxes_cxcywh', 'e2e_person_scores', 'e2e_max_detections', 'e2e_iou_threshold', 'e2e_score_threshold'],
+                         ['e2e_selected'], center_point_box=1),
+
+        # Углы рамок [B, N, 4] в формате (x1, y1, x2, y2)
+        helper.make_node('Slice', ['e2e_boxes_cxcywh', 'e2e_xy_start', 'e2e_xy_end', 'e2e_axis_2'], ['e2e_centers']),
+        helper.make_node('Slice', ['e2e_boxes_cxcywh', 'e2e_xy_end', 'e2e_wh_end', 'e2e_axis_2'], ['e2e_sizes']),
+        helper.make_node('Mul', ['e2e_sizes', 'e2e_half'], ['e2e_half_sizes']),
+        helper.make_node('Sub', ['e2e_centers', 'e2e_half_sizes'], ['e2e_top_left']),
+        helper.make_node('Add', ['e2e_centers', 'e2e_half_sizes'], ['e2e_bottom_right']),
+        helper.make_node('Concat', ['e2e_top_left', 'e2e_bottom_right'], ['e2e_boxes_xyxy'], axis=2),
+
+        # Сборка строк (номер кадра, x1, y1, x2, y2, score)
+        helper.make_node('Gather', ['e2e_selected', 'e2e_batch_box_columns'], ['e2e_batch_box'], axis=1),
+        helper.make_node('GatherND', ['e2e_boxes_xyxy', 'e2e_batch_box'], ['e2e_selected_boxes']),
+        helper.make_node('GatherND', ['e2e_person_scores', 'e2e_selected'], ['e2e_selected_scores_flat']),
+        helper.make_node('Reshape', ['e2e_selected_scores_flat', 'e2e_column'], ['e2e_selected_scores']),
+        helper.make_node('Slice', ['e2e_selected', 'e2e_xy_start', 'e2e_axis_1', 'e2e_axis_1'], ['e2e_batch_index_i64']),
+        helper.make_node('Cast', ['e2e_batch_index_i64'], ['e2e_batch_index'], to=TensorProto.FLOAT),
+        helper.make_node('Concat', ['e2e_batch_index', 'e2e_selected_boxes', 'e2e_selected_scores'], [name], axis=1),
+    ])
+    graph.output.append(helper.make_tensor_value_info(name, TensorProto.FLOAT, ['num_detections', 6]))
+    return model
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='исходная модель YOLOv8 с выходом [1, 4 + nc, N]')
+    parser.add_argument('output', help='путь для модели с готовыми рамками')
+    parser.add_argument('--class-id', type=int, default=0, help='класс людей')
+    parser.add_argument('--score-threshold', type=float, default=0.5)
+    parser.add_argument('--iou-threshold', type=float, default=0.45)
+    parser.add_argument('--max-detections', type=int, default=100, help='наибольшее число рамок на кадр')
+    args = parser.parse_args()
+
+    model = onnx.load(args.input)
+    model = append_postprocessing(model, args.class_id, args.score_threshold, args.iou_threshold, args.max_detections)
+    onnx.checker.check_model(model)
+    onnx.save(model, args.output)
+    print(f'saved {args.output}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,162 @@
+"""Оставляет в голове ONNX-детектора YOLOv8 только класс людей.
+
+Последние свёртки ветки классов урезаются с nc выходных каналов до одного, поэтому голова
+считает и выдаёт одну оценку вместо nc: выход output0 меняется с [1, 4 + nc, N] на [1, 5, N].
+Константы формы после свёрток (Reshape на 4 * reg_max + nc каналов, Split на [4 * reg_max, nc])
+исправляются под один класс. HumanDetector берёт число классов из формы выхода,
+поэтому урезанная модель подключается без изменений в config.json.
+
+Если установлен onnxruntime, выход урезанной модели сверяется с исходной на случайном входе.
+Учтите, что без остальных классов предложение считается человеком по одной его оценке,
+без проверки, что люди - класс с наибольшей оценкой.
+
+Запуск: python tools/prune_detector_head.py models/human_recognizer.onnx models/human_recognizer_person.onnx
+Требуется пакет onnx.
+"""
+import argparse
+
+import numpy as np
+import onnx
+from onnx import numpy_helper
+
+
+def output_channels(model):
+    output = next((o for o in model.graph.output if o.name == 'output0'), model.graph.output[0])
+    dims = output.type.tensor_type.shape.dim
+    if len(dims) != 3 or not dims[1].HasField('dim_value'):
+        raise ValueError(f'ожидался выход [1, 4 + nc, N] с известным числом каналов, получено {output.name}')
+    return output, dims[1].dim_value
+
+
+def producers(graph):
+    return {o: node for node in graph.node for o in node.output}
+
+
+def consumers(graph):
+    result = {}
+    for node in graph.node:
+        for i in node.input:
+            result.setdefault(i, []).append(node)
+    return result
+
+
+def int_constants(graph):
+    """Целочисленные константы графа по имени: инициализаторы и узлы Constant."""
+    result = {name: init for name, init in ((i.name, i) for i in graph.initializer)}
+    for node in graph.node:
+        if node.op_type == 'Constant':
+            for attr in node.attribute:
+                if attr.name == 'value':
+                    result[node.output[0]] = attr.t
+    return result
+
+
+def replace_value(tensor, old, new):
+    values = numpy_helper.to_array(tensor)
+    if values.dtype.kind != 'i' or old not in values:
+        return False
+    values = np.where(values == old, new, values).astype(values.dtype)
+    tensor.CopyFrom(numpy_helper.from_array(values, tensor.name))
+    return True
+
+
+def prune(model, class_id):
+    graph = model.graph
+    output, channels = output_channels(model)
+    num_classes = channels - 4
+    if not 0 <= class_id < num_classes:
+        raise ValueError(f'класс {class_id} вне диапазона [0, {num_classes})')
+    if num_classes == 1:
+        raise ValueError('в модели уже один класс')
+
+    initializers = {i.name: i for i in graph.initializer}
+    users = consumers(graph)
+    made_by = producers(graph)
+
+    # Свёртки ветки классов: nc выходных каналов, выход склеивается с веткой рамок по каналам
+    box_channels = set()
+    pruned = 0
+    for node in graph.node:
+        if node.op_type != 'Conv' or node.input[1] not in initializers:
+            continue
+        weight = numpy_helper.to_array(initializers[node.input[1]])
+        concat = next((n for n in users.get(node.output[0], []) if n.op_type == 'Concat'), None)
+        if weight.shape[0] != num_classes or concat is None:
+            continue
+
+        initializers[node.input[1]].CopyFrom(numpy_helper.from_array(weight[class_id:class_id + 1], node.input[1]))
+        if len(node.input) > 2 and node.input[2] in initializers:
+            bias = numpy_helper.to_array(initializers[node.input[2]])
+            initializers[node.input[2]].CopyFrom(numpy_helper.from_array(bias[class_id:class_id + 1], node.input[2]))
+        pruned += 1
+
+        # Каналы ветки рамок (4 * reg_max) - у соседнего входа того же Concat
+        for other in concat.input:
+            partner = made_by.get(other)
+            if other != node.output[0] and partner is not None and partner.op_type == 'Conv' and partner.input[1] in initializers:
+                box_channels.add(initializers[partner.input[1]].dims[0])
+
+    if pruned == 0:
+        raise ValueError(f'не найдены свёртки ветки классов с {num_classes} выходами')
+    if len(box_channels) != 1:
+        raise ValueError(f'не удалось определить каналы ветки рамок: {sorted(box_channels)}')
+    box_channels = box_channels.pop()
+
+    # Формы после склейки: 4 * reg_max + nc -> 4 * reg_max + 1, размеры Split: nc -> 1
+    constants = int_constants(graph)
+    for node in graph.node:
+        if node.op_type == 'Reshape' and node.input[1] in constants:
+            replace_value(constants[node.input[1]], box_channels + num_classes, box_channels + 1)
+        elif node.op_type == 'Split':
+            if len(node.input) > 1 and node.input[1] in constants:
+                replace_value(constants[node.input[1]], num_classes, 1)
+            for attr in node.attribute:
+                if attr.name == 'split':
+                    attr.ints[:] = [1 if v == num_classes else v for v in attr.ints]
+
+    output.type.tensor_type.shape.dim[1].dim_value = 5
+    del graph.value_info[:]
+    model = onnx.shape_inference.infer_shapes(model)
+    print(f'pruned {pruned} classification convs: {num_classes} -> 1 class (class {class_id})')
+    return model
+
+
+def verify(original_path, pruned_model, class_id):
+    try:
+        import onnxruntime as ort
+    except ImportError:
+        print('onnxruntime not installed, skipping verification')
+        return
+
+    original = ort.InferenceSession(original_path, providers=['CPUExecutionProvider'])
+    pruned = ort.InferenceSession(pruned_model.SerializeToString(), providers=['CPUExecutionProvider'])
+    model_input = original.get_inputs()[0]
+    shape = [d if isinstance(d, int) and d > 0 else (1 if i == 0 else 640) for i, d in enumerate(model_input.shape)]
+    dtype = np.uint8 if 'uint8' in model_input.type else np.float32
+    data = np.random.default_rng(0).uniform(0, 255 if dtype == np.uint8 else 1, shape).astype(dtype)
+
+    expected = original.run(['output0'], {model_input.name: data})[0]
+    expected = expected[:, [0, 1, 2, 3, 4 + class_id], :]
+    actual = pruned.run(['output0'], {model_input.name: data})[0]
+    diff = float(np.abs(expected - actual).max())
+    print(f'max abs difference against the original model: {diff:.3g}')
+    if diff > 1e-3:
+        raise SystemExit('pruned model differs from the original')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='исходная модель YOLOv8 с выходом [1, 4 + nc, N]')
+    parser.add_argument('output', help='путь для модели с одним классом')
+    parser.add_argument('--class-id', type=int, default=0, help='оставляемый класс')
+    args = parser.parse_args()
+
+    model = prune(onnx.load(args.input), args.class_id)
+    onnx.checker.check_model(model)
+    verify(args.input, model, args.class_id)
+    onnx.save(model, args.output)
+    print(f'saved {args.output}')
+
+
+if __name__ == '__main__':
+    main()